@@ -5,9 +5,35 @@
 #include <vector>
 #include <algorithm>
 #include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
 #include <chrono> // For better sleep
 #include <thread> // For std::this_thread::sleep_for
 #include <limits> // Required for numeric_limits
+#include <functional>
+#include <new> // Counting operator new (COUNT_ALLOCATIONS builds)
+#include <atomic>
+#include <cstdint> // Fixed-width masks for the bitboard
+#include <array> // Compile-time lookup tables
+#include <bitset> // Stone masks for N x N boards
+#include <cmath> // UCT exploration term, Elo
+#include <set>
+#include <unordered_map>
+#include <mutex> // Metrics shard registry
+#include <type_traits> // GameState must stay trivially copyable
+#include <memory>
+
+// SIMD kernels for the batch classifier (SSE2 is part of x86-64; AVX2 is
+// compiled per function and chosen at runtime)
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #define SIMD_X86 1
+    #if defined(__GNUC__)
+        #define SIMD_AVX2 1
+    #endif
+#endif
 
 #ifdef _WIN32
     #include <windows.h>
@@ -15,7 +41,26 @@
 #else
     #include <unistd.h>
     #include <termios.h> // For non-buffered input on Linux/macOS
+    #include <poll.h> // Polled keyboard input
+    #include <csignal> // Restore the terminal when killed
+    #include <cerrno>
     #include <sys/ioctl.h> // For terminal size
+    #include <sys/mman.h> // Memory-mapped game log
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <sys/wait.h> // --drive runs the game as a child process
+    #include <climits> // PATH_MAX
+    #ifdef __linux__
+        // Server mode (epoll, eventfd, sockets)
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+        #include <sys/socket.h>
+        #include <netinet/in.h>
+        #include <netinet/tcp.h>
+        #include <arpa/inet.h>
+        #include <condition_variable>
+        #include <deque>
+    #endif
 #endif
 
 // ANSI Escape Codes for colors and text styles
@@ -41,6 +86,35 @@
 
 using namespace std;
 
+// Allocation counting for the benchmark suite's allocs/op column. Replacing the
+// global operator new would route every allocation in the game, the server and
+// the solvers through an atomic, so it is only compiled into benchmark builds:
+//   g++ -std=c++17 -O2 -pthread -DCOUNT_ALLOCATIONS TicTacToe.cpp -o TicTacToe
+#ifdef COUNT_ALLOCATIONS
+static std::atomic<long long> heapAllocations(0);
+
+// Kept out of line so GCC does not pair the inlined malloc/free with new/delete
+// and report a false -Wmismatched-new-delete
+#if defined(__GNUC__)
+    #define NO_INLINE __attribute__((noinline))
+#else
+    #define NO_INLINE
+#endif
+
+NO_INLINE void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+NO_INLINE void operator delete(void* p) noexcept { free(p); }
+NO_INLINE void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Allocations so far, or -1 when the build does not count them
+long long heapAllocationCount() { return heapAllocations.load(std::memory_order_relaxed); }
+#else
+long long heapAllocationCount() { return -1; }
+#endif
+
 // Function to enable ANSI escape codes on Windows
 void enableAnsiColors() {
 #ifdef _WIN32
@@ -52,720 +126,5972 @@ void enableAnsiColors() {
 #endif
 }
 
+// Set when a script drives the game (--drive): pauses and typing effects are
+// only there for people watching
+bool skipCosmeticDelays = false;
+
 // Custom sleep function for cross-platform compatibility
 void customSleep(int milliseconds) {
+    if (skipCosmeticDelays) return;
     std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
 }
 
-// Non-buffered input for "Press any key to continue"
-char getch_custom() {
-#ifdef _WIN32
-    return _getch();
-#else
-    struct termios oldt, newt;
-    int ch;
-    tcgetattr(STDIN_FILENO, &oldt);
-    newt = oldt;
-    newt.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-    ch = getchar();
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-    return (char)ch;
-#endif
-}
+// ---------------------------------------------------------------------------
+// Instrumentation: counters and log2 histograms for the AI, render and input
+// paths. Every thread writes only its own cache-line-aligned shard, so the hot
+// paths never contend; a snapshot sums the shards. Shown on the Engine Stats
+// screen and exported as JSON or Prometheus text.
+// ---------------------------------------------------------------------------
 
-// Player statistics structure
-struct PlayerStats {
-    string name;
-    int wins;
-    int losses;
-    int ties;
-    int totalGames;
-    double winRate;
-    
-    PlayerStats() : wins(0), losses(0), ties(0), totalGames(0), winRate(0.0) {}
-    
-    void updateStats(int result) { // 1=win, 0=tie, -1=loss
-        totalGames++;
-        if (result == 1) wins++;
-        else if (result == 0) ties++;
-        else losses++;
-        winRate = (totalGames > 0) ? (double)wins / totalGames * 100 : 0.0;
+enum MetricCounter {
+    COUNTER_AI_MOVES,
+    COUNTER_SEARCHES,
+    COUNTER_SEARCH_NODES,
+    COUNTER_SEARCH_EXPANDED,  // Nodes whose moves were generated; nodes / expanded = branching factor
+    COUNTER_TT_HITS,
+    COUNTER_TT_MISSES,
+    COUNTER_BOOK_HITS,
+    COUNTER_SOLVED_HITS,
+    COUNTER_PONDER_HITS,
+    COUNTER_PONDER_MISSES,
+    COUNTER_MCTS_PLAYOUTS,
+    COUNTER_FRAMES,
+    COUNTER_FRAME_BYTES,
+    COUNTER_COUNT
+};
+
+enum MetricHistogram {
+    HIST_AI_MOVE_US,
+    HIST_SEARCH_DEPTH,
+    HIST_RENDER_US,
+    HIST_INPUT_WAIT_MS,
+    HIST_COUNT
+};
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "ai_moves_total", "searches_total", "search_nodes_total", "search_expanded_total", "tt_hits_total",
+    "tt_misses_total", "book_hits_total", "solved_hits_total", "ponder_hits_total", "ponder_misses_total",
+    "mcts_playouts_total", "frames_total", "frame_bytes_total"};
+const char* const HISTOGRAM_NAMES[HIST_COUNT] = {"ai_move_time_us", "search_depth", "render_time_us", "input_wait_ms"};
+
+const char* const METRICS_JSON_FILE = "tictactoe_metrics.json";
+const char* const METRICS_PROMETHEUS_FILE = "tictactoe_metrics.prom";
+
+// Bucket b holds values in [2^(b-1), 2^b); bucket 0 holds 0
+static constexpr int HIST_BUCKETS = 40;
+
+struct HistogramSnapshot {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t count, sum, max;
+
+    double mean() const { return count ? (double)sum / count : 0.0; }
+
+    // Upper edge of the bucket holding the p-th quantile (0 < p <= 1)
+    uint64_t percentile(double p) const {
+        if (count == 0) return 0;
+        uint64_t rank = (uint64_t)ceil(p * count), seen = 0;
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= rank) return min(b == 0 ? 0 : (uint64_t(1) << b) - 1, max);
+        }
+        return max;
     }
 };
 
-// Game class untuk mengelola semua aspek permainan
-class TicTacToeGame {
+struct MetricsSnapshot {
+    uint64_t counters[COUNTER_COUNT];
+    HistogramSnapshot histograms[HIST_COUNT];
+    int shards; // Threads that have recorded anything
+};
+
+// Written by one thread only, so updates are a relaxed load + store (no lock prefix)
+struct alignas(64) MetricShard {
+    struct Histogram {
+        std::atomic<uint64_t> buckets[HIST_BUCKETS];
+        std::atomic<uint64_t> count, sum, max;
+    };
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    Histogram histograms[HIST_COUNT];
+
+    MetricShard() {
+        for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+        for (Histogram& h : histograms) {
+            for (auto& b : h.buckets) b.store(0, std::memory_order_relaxed);
+            h.count.store(0, std::memory_order_relaxed);
+            h.sum.store(0, std::memory_order_relaxed);
+            h.max.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void bump(std::atomic<uint64_t>& cell, uint64_t amount) {
+        cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+class Metrics {
 private:
-    char board[9];
-    PlayerStats player1Stats, player2Stats, computerStats;
-    vector<string> gameHistory;
-    bool soundEnabled;
-    int totalGamesPlayed;
-    
+    std::mutex lock;
+    vector<MetricShard*> shards; // Kept for the whole run so finished threads still count
+    vector<MetricShard*> idle;   // Shards of threads that exited, reused by new ones
+
+    // Hands the shard back when its thread exits (MCTS and the server start threads per job)
+    struct ShardLease {
+        MetricShard* shard = nullptr;
+        ~ShardLease() {
+            if (shard) Metrics::global().release(shard);
+        }
+    };
+
+    MetricShard* acquire() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!idle.empty()) {
+            MetricShard* shard = idle.back();
+            idle.pop_back();
+            return shard;
+        }
+        shards.push_back(new MetricShard());
+        return shards.back();
+    }
+
+    void release(MetricShard* shard) {
+        std::lock_guard<std::mutex> guard(lock);
+        idle.push_back(shard);
+    }
+
 public:
-    TicTacToeGame() : soundEnabled(true), totalGamesPlayed(0) {
-        clearBoard();
-        enableAnsiColors(); // Enable ANSI colors at startup
+    static Metrics& global() {
+        static Metrics* metrics = new Metrics(); // Never destroyed: threads may still report during exit
+        return *metrics;
     }
-    
-    void clearBoard() {
-        for(int i = 0; i < 9; i++) board[i] = ' ';
+
+    static MetricShard& local() {
+        thread_local ShardLease lease;
+        if (!lease.shard) lease.shard = global().acquire();
+        return *lease.shard;
     }
-    
-    void clearScreen() {
-        #ifdef _WIN32
-            system("cls");
-        #else
-            // Clear screen and move cursor to top-left
-            cout << "\033[2J\033[H";
-        #endif
+
+    static void add(MetricCounter counter, uint64_t amount = 1) {
+        MetricShard::bump(local().counters[counter], amount);
     }
-    
-    void playSound(string sound) {
-        if (!soundEnabled) return;
-        #ifdef _WIN32
-            if (sound == "move") Beep(800, 100);
-            else if (sound == "win") Beep(1000, 200);
-            else if (sound == "lose") Beep(400, 300);
-            else if (sound == "tie") Beep(600, 150);
-            else if (sound == "select") Beep(700, 50); // New sound for menu selection
-        #endif
+
+    static void record(MetricHistogram histogram, uint64_t value) {
+        MetricShard::Histogram& h = local().histograms[histogram];
+        int bucket = 0;
+        while (bucket < HIST_BUCKETS - 1 && (value >> bucket) != 0) bucket++;
+        MetricShard::bump(h.buckets[bucket], 1);
+        MetricShard::bump(h.count, 1);
+        MetricShard::bump(h.sum, value);
+        if (value > h.max.load(std::memory_order_relaxed)) h.max.store(value, std::memory_order_relaxed);
     }
 
-    // Typing effect for messages
-    void typeMessage(const string& message, int delay_ms = 30) {
-        for (char c : message) {
-            cout << c << flush;
-            customSleep(delay_ms);
+    MetricsSnapshot snapshot() {
+        MetricsSnapshot snap;
+        memset(&snap, 0, sizeof(snap));
+        std::lock_guard<std::mutex> guard(lock);
+        snap.shards = (int)shards.size();
+        for (const MetricShard* shard : shards) {
+            for (int c = 0; c < COUNTER_COUNT; c++) snap.counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+            for (int h = 0; h < HIST_COUNT; h++) {
+                const MetricShard::Histogram& from = shard->histograms[h];
+                HistogramSnapshot& to = snap.histograms[h];
+                for (int b = 0; b < HIST_BUCKETS; b++) to.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+                to.count += from.count.load(std::memory_order_relaxed);
+                to.sum += from.sum.load(std::memory_order_relaxed);
+                to.max = max(to.max, from.max.load(std::memory_order_relaxed));
+            }
         }
-        cout << RESET; // Ensure color reset after messageeeeeeeeeeeee
-    }
-    
-    void printHeader() {
-        clearScreen();
-        cout << BOLD << BG_BLUE << WHITE << "============================================================\n";
-        cout << "             BERN'S TIC TAC TOE PROJECT                  \n";
-        cout << "              " << YELLOW << "Created by: Group Bern" << WHITE << "                 \n";
-        cout << "============================================================" << RESET << "\n\n";
-    }
-    
-    void drawAdvancedBoard() {
-        cout << BOLD << CYAN << "\n     * GAME BOARD *\n\n" << RESET;
-        cout << BLUE << "     |     |     \n";
-        cout << "  " << (board[0] == 'X' ? RED : (board[0] == 'O' ? GREEN : WHITE)) << board[0] << BLUE << "  |  "
-             << (board[1] == 'X' ? RED : (board[1] == 'O' ? GREEN : WHITE)) << board[1] << BLUE << "  |  "
-             << (board[2] == 'X' ? RED : (board[2] == 'O' ? GREEN : WHITE)) << board[2] << BLUE << "  \n";
-        cout << "_____|_____|_____\n";
-        cout << "     |     |     \n";
-        cout << "  " << (board[3] == 'X' ? RED : (board[3] == 'O' ? GREEN : WHITE)) << board[3] << BLUE << "  |  "
-             << (board[4] == 'X' ? RED : (board[4] == 'O' ? GREEN : WHITE)) << board[4] << BLUE << "  |  "
-             << (board[5] == 'X' ? RED : (board[5] == 'O' ? GREEN : WHITE)) << board[5] << BLUE << "  \n";
-        cout << "_____|_____|_____\n";
-        cout << "     |     |     \n";
-        cout << "  " << (board[6] == 'X' ? RED : (board[6] == 'O' ? GREEN : WHITE)) << board[6] << BLUE << "  |  "
-             << (board[7] == 'X' ? RED : (board[7] == 'O' ? GREEN : WHITE)) << board[7] << BLUE << "  |  "
-             << (board[8] == 'X' ? RED : (board[8] == 'O' ? GREEN : WHITE)) << board[8] << BLUE << "  \n";
-        cout << "     |     |     \n" << RESET;
-        cout << '\n';
+        return snap;
     }
-    
-    void showMenu() {
-        printHeader();
-        cout << BOLD << YELLOW << "*** SELECT GAME MODE ***\n\n" << RESET;
-        cout << "1. " << GREEN << "VS Computer (AI Challenge)\n" << RESET;
-        cout << "2. " << CYAN << "Multiplayer (Local Battle)\n" << RESET;
-        cout << "3. " << MAGENTA << "View Statistics\n" << RESET;
-        cout << "4. " << WHITE << "Toggle Sound (" << (soundEnabled ? GREEN "ON" : RED "OFF") << WHITE << ")\n" << RESET;
-        cout << "5. " << BLUE << "Game History\n" << RESET;
-        cout << "6. " << RED << "Exit Game\n\n" << RESET;
-        cout << BOLD << "Enter your choice (1-6): " << RESET;
+};
+
+// Records the scope's wall time into a histogram
+class MetricTimer {
+private:
+    MetricHistogram histogram;
+    std::chrono::steady_clock::time_point start;
+    bool millis;
+
+public:
+    explicit MetricTimer(MetricHistogram h, bool inMillis = false)
+        : histogram(h), start(std::chrono::steady_clock::now()), millis(inMillis) {}
+    ~MetricTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        Metrics::record(histogram, millis ? std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+                                          : std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
     }
-    
-    int getDifficultyLevel() {
-        int difficulty;
-        printHeader(); // Clear and print header again for clean look
-        cout << BOLD << YELLOW << "*** SELECT AI DIFFICULTY ***\n\n" << RESET;
-        cout << "1. " << GREEN << "Easy Mode (Random moves)\n" << RESET;
-        cout << "2. " << CYAN << "Medium Mode (Smart offense)\n" << RESET;
-        cout << "3. " << MAGENTA << "Hard Mode (Master AI)\n" << RESET;
-        cout << "4. " << RED << "Impossible Mode (Unbeatable)\n\n" << RESET;
-        
-        do {
-            cout << BOLD << "Choose difficulty (1-4): " << RESET;
-            cin >> difficulty;
-            playSound("select");
-            if (cin.fail() || difficulty < 1 || difficulty > 4) {
-                cin.clear(); // Clear error flags
-                cin.ignore(numeric_limits<streamsize>::max(), '\n'); // Discard invalid input
-                cout << RED << "Invalid choice! Please select 1-4.\n" << RESET;
-                customSleep(500);
-            }
-        } while (difficulty < 1 || difficulty > 4);
-        
-        // Membersihkan buffer setelah membaca integer 'difficulty'
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        
-        return difficulty;
+};
+
+// Single-line JSON, so it also fits in one server reply
+string metricsJson(const MetricsSnapshot& snap) {
+    ostringstream out;
+    out << "{\"threads\":" << snap.shards << ",\"counters\":{";
+    for (int c = 0; c < COUNTER_COUNT; c++) out << (c ? "," : "") << '"' << COUNTER_NAMES[c] << "\":" << snap.counters[c];
+    out << "},\"histograms\":{";
+    for (int h = 0; h < HIST_COUNT; h++) {
+        const HistogramSnapshot& hist = snap.histograms[h];
+        out << (h ? "," : "") << '"' << HISTOGRAM_NAMES[h] << "\":{\"count\":" << hist.count << ",\"sum\":" << hist.sum
+            << ",\"max\":" << hist.max << ",\"p50\":" << hist.percentile(0.5) << ",\"p95\":" << hist.percentile(0.95)
+            << ",\"p99\":" << hist.percentile(0.99) << ",\"buckets\":[";
+        int last = HIST_BUCKETS - 1;
+        while (last > 0 && hist.buckets[last] == 0) last--;
+        for (int b = 0; b <= last; b++) out << (b ? "," : "") << hist.buckets[b];
+        out << "]}";
     }
-    
-    void playerMove(char player, string playerName) {
-        int choice;
-        bool validMove = false;
-        
-        do {
-            cout << BOLD << "Player " << (player == 'X' ? RED : GREEN) << playerName << RESET << " (" << (player == 'X' ? RED : GREEN) << player << RESET << "), choose position (1-9): " << RESET;
-            cin >> choice;
-            
-            if (cin.fail()) {
-                cin.clear(); // Clear error flags
-                cin.ignore(numeric_limits<streamsize>::max(), '\n'); // Discard invalid input
-                cout << RED << "Invalid input! Please enter a number.\n" << RESET;
-                customSleep(500);
-                continue;
-            }
+    out << "}}";
+    return out.str();
+}
 
-            if (choice < 1 || choice > 9) {
-                cout << RED << "Invalid position! Choose 1-9.\n" << RESET;
-                customSleep(500);
-                continue;
-            }
-            
-            choice--; // Adjust to 0-indexed array
-            if (board[choice] == ' ') {
-                board[choice] = player;
-                playSound("move");
-                validMove = true;
-            } else {
-                cout << RED << "Position occupied! Try another spot.\n" << RESET;
-                customSleep(500);
-            }
-        } while (!validMove);
-        
-        // Membersihkan buffer setelah membaca integer 'choice'
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+// Prometheus text exposition format; histograms use cumulative "le" buckets
+string metricsPrometheus(const MetricsSnapshot& snap) {
+    ostringstream out;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out << "# TYPE tictactoe_" << COUNTER_NAMES[c] << " counter\n"
+            << "tictactoe_" << COUNTER_NAMES[c] << " " << snap.counters[c] << "\n";
     }
-    
-    void computerMove(char computer, char player, int difficulty) {
-        int choice = -1;
-        
-        cout << BOLD << YELLOW;
-        typeMessage("Computer is thinking...", 50);
-        cout << RESET << "\n";
-        
-        customSleep(1000); // Delay for dramatic effect
-        
-        switch (difficulty) {
-            case 1: // Easy - Random
-                do {
-                    choice = rand() % 9;
-                } while (board[choice] != ' ');
-                break;
-                
-            case 2: // Medium - Win if possible, then block, then take center/corner, then random
-                choice = findWinningMove(computer); // Try to win
-                if (choice == -1) {
-                    choice = findWinningMove(player); // Try to block
-                }
-                if (choice == -1) { // If no immediate win or block, take center or corner
-                    if (board[4] == ' ') choice = 4; // Take center
-                    else if (board[0] == ' ') choice = 0;
-                    else if (board[2] == ' ') choice = 2;
-                    else if (board[6] == ' ') choice = 6;
-                    else if (board[8] == ' ') choice = 8;
-                }
-                if (choice == -1) { // Fallback to random
-                    do {
-                        choice = rand() % 9;
-                    } while (board[choice] != ' ');
-                }
-                break;
-                
-            case 3: // Hard - Win or block, then strategic moves
-                choice = findWinningMove(computer); // Try to win
-                if (choice == -1) choice = findWinningMove(player); // Try to block
-                if (choice == -1) { // If no immediate win or block, apply strategy
-                    // Take center if available
-                    if (board[4] == ' ') choice = 4;
-                    // Take opposite corner if player took a corner
-                    else if (board[0] == player && board[8] == ' ') choice = 8;
-                    else if (board[2] == player && board[6] == ' ') choice = 6;
-                    else if (board[6] == player && board[2] == ' ') choice = 2;
-                    else if (board[8] == player && board[0] == ' ') choice = 0;
-                    // Take any available corner
-                    else if (board[0] == ' ') choice = 0;
-                    else if (board[2] == ' ') choice = 2;
-                    else if (board[6] == ' ') choice = 6;
-                    else if (board[8] == ' ') choice = 8;
-                    // Take any available side
-                    else if (board[1] == ' ') choice = 1;
-                    else if (board[3] == ' ') choice = 3;
-                    else if (board[5] == ' ') choice = 5;
-                    else if (board[7] == ' ') choice = 7;
-                }
-                if (choice == -1) { // Fallback to random (shouldn't happen often in Hard)
-                     do {
-                        choice = rand() % 9;
-                    } while (board[choice] != ' ');
-                }
-                break;
-                
-            case 4: // Impossible - Minimax algorithm
-                choice = minimaxMove(computer, player);
-                break;
+    for (int h = 0; h < HIST_COUNT; h++) {
+        const HistogramSnapshot& hist = snap.histograms[h];
+        string name = string("tictactoe_") + HISTOGRAM_NAMES[h];
+        out << "# TYPE " << name << " histogram\n";
+        uint64_t cumulative = 0;
+        for (int b = 0; b < HIST_BUCKETS && cumulative < hist.count; b++) {
+            cumulative += hist.buckets[b];
+            out << name << "_bucket{le=\"" << (b == 0 ? 0 : (uint64_t(1) << b) - 1) << "\"} " << cumulative << "\n";
         }
-        
-        board[choice] = computer;
-        cout << BOLD << CYAN << "Computer chose position " << (choice + 1) << "!\n" << RESET;
-        playSound("move");
+        out << name << "_bucket{le=\"+Inf\"} " << hist.count << "\n"
+            << name << "_sum " << hist.sum << "\n" << name << "_count " << hist.count << "\n";
     }
-    
-    int findWinningMove(char player) {
-        for (int i = 0; i < 9; i++) {
-            if (board[i] == ' ') {
-                board[i] = player;
-                if (checkWinner() == player) {
-                    board[i] = ' '; // Undo the move
-                    return i;
-                }
-                board[i] = ' '; // Undo the move
-            }
-        }
-        return -1;
+    return out.str();
+}
+
+// Keyboard input for the whole session. The terminal goes into raw mode once
+// (no line buffering, no echo; Ctrl-C still works) and is restored at exit or
+// on a fatal signal, instead of toggling termios on every key. Keys are polled, so callers can
+// keep working (e.g. show AI progress) while the player is typing.
+class TerminalInput {
+private:
+#ifndef _WIN32
+    struct termios saved;
+    struct termios rawMode; // Reapplied after a stop (Ctrl-Z) and resume
+#endif
+    bool raw;
+    bool echo;          // Raw mode turns terminal echo off, so typed keys are echoed here
+    bool announce;      // Driven by a script: mark every point where the game waits for input
+    bool skipNewline;   // A '\r' just ended a line; swallow a '\n' right after it
+
+    static void restoreAtExit();
+#ifndef _WIN32
+    static void onSignal(int sig);
+
+    static void handle(int sig, void (*handler)(int)) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(sig, &action, nullptr);
     }
-    
-    int minimaxMove(char computer, char player) {
-        int bestMove = -1;
-        int bestScore = -1000; // Initialize with a very low score
-        
-        for (int i = 0; i < 9; i++) {
-            if (board[i] == ' ') {
-                board[i] = computer;
-                int score = minimax(false, computer, player); // Opponent's turn
-                board[i] = ' '; // Undo the move
-                
-                if (score > bestScore) {
-                    bestScore = score;
-                    bestMove = i;
-                }
+#endif
+
+public:
+    static constexpr int KEY_TIMEOUT = -1;
+
+    TerminalInput() : raw(false), echo(false), announce(false), skipNewline(false) {}
+
+    // Invisible to terminals (an APC string); the --drive harness times turns by it
+    static constexpr const char* INPUT_MARKER = "\033_tictactoe-input\033\\";
+
+    void announceInput(bool on) { announce = on; }
+
+    // Called once per prompt, right before blocking for the answer
+    void markWaiting() {
+        if (announce) cout << INPUT_MARKER << flush;
+    }
+
+    void begin() {
+        if (raw) return;
+#ifdef _WIN32
+        echo = true;
+#else
+        if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved) != 0) return; // Piped input: nothing to set up
+        rawMode = saved;
+        rawMode.c_lflag &= ~(ICANON | ECHO);
+        rawMode.c_cc[VMIN] = 1;
+        rawMode.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &rawMode);
+        echo = true;
+        atexit(restoreAtExit);
+        // Ctrl-C, kill or a closed terminal would otherwise leave the shell without echo
+        for (int sig : {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGTSTP, SIGCONT}) handle(sig, onSignal);
+#endif
+        raw = true;
+    }
+
+    void end() {
+        if (!raw) return;
+#ifndef _WIN32
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+#endif
+        raw = false;
+    }
+
+    // Next key, or KEY_TIMEOUT after timeoutMs (< 0 waits forever). End of
+    // input ends the session: there is nobody left to play.
+    int readKey(int timeoutMs) {
+        cout << flush;
+#ifdef _WIN32
+        auto start = std::chrono::steady_clock::now();
+        while (!_kbhit()) {
+            if (timeoutMs >= 0 && std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(timeoutMs)) {
+                return KEY_TIMEOUT;
             }
+            Sleep(10);
         }
-        return bestMove;
+        return _getch();
+#else
+        struct pollfd in = {STDIN_FILENO, POLLIN, 0};
+        int ready;
+        // poll is never restarted after a signal: a Ctrl-Z/fg cycle must not end an untimed wait
+        while ((ready = poll(&in, 1, timeoutMs)) < 0 && errno == EINTR && timeoutMs < 0) {}
+        if (ready == 0 || (ready < 0 && errno == EINTR)) return KEY_TIMEOUT;
+        unsigned char c;
+        if (ready < 0 || read(STDIN_FILENO, &c, 1) != 1) {
+            end();
+            cout << RESET << "\n";
+            exit(0);
+        }
+        return c;
+#endif
     }
-    
-    int minimax(bool isMaximizing, char computer, char player) {
-        char winner = checkWinner();
-        if (winner == computer) return 1; // Computer wins
-        if (winner == player) return -1;  // Player wins
-        if (isTie()) return 0;            // It's a tie
-        
-        if (isMaximizing) { // Computer's turn (maximizing player)
-            int bestScore = -1000;
-            for (int i = 0; i < 9; i++) {
-                if (board[i] == ' ') {
-                    board[i] = computer;
-                    int score = minimax(false, computer, player);
-                    board[i] = ' ';
-                    bestScore = max(score, bestScore);
-                }
+
+    // One line with backspace editing. `onIdle` runs whenever no key arrives
+    // for pollMs, so the caller can refresh status while the player thinks.
+    string readLine(const std::function<void()>& onIdle = nullptr, int pollMs = 100) {
+        MetricTimer waiting(HIST_INPUT_WAIT_MS, true);
+        markWaiting();
+        string line;
+        while (true) {
+            int key = readKey(onIdle ? pollMs : -1);
+            if (key == KEY_TIMEOUT) {
+                if (onIdle) onIdle();
+                continue;
             }
-            return bestScore;
-        } else { // Player's turn (minimizing player)
-            int bestScore = 1000;
-            for (int i = 0; i < 9; i++) {
-                if (board[i] == ' ') {
-                    board[i] = player;
-                    int score = minimax(true, computer, player);
-                    board[i] = ' ';
-                    bestScore = min(score, bestScore);
+            if (key == '\n' && skipNewline) {
+                skipNewline = false;
+                continue;
+            }
+            skipNewline = (key == '\r');
+            if (key == '\r' || key == '\n') break;
+            if (key == 127 || key == 8) {
+                if (!line.empty()) {
+                    line.pop_back();
+                    if (echo) cout << "\b \b";
                 }
+            } else if (key >= 32 && key < 127) {
+                line += (char)key;
+                if (echo) cout << (char)key;
             }
-            return bestScore;
         }
+        if (echo) cout << "\n";
+        return line;
     }
-    
-    char checkWinner() {
-        // Check rows, columns, diagonals
-        int winPatterns[8][3] = {
-            {0,1,2}, {3,4,5}, {6,7,8}, // rows
-            {0,3,6}, {1,4,7}, {2,5,8}, // columns
-            {0,4,8}, {2,4,6}           // diagonals
-        };
-        
-        for (int i = 0; i < 8; i++) {
-            if (board[winPatterns[i][0]] != ' ' &&
-                board[winPatterns[i][0]] == board[winPatterns[i][1]] &&
-                board[winPatterns[i][1]] == board[winPatterns[i][2]]) {
-                return board[winPatterns[i][0]];
-            }
-        }
-        return ' ';
+
+    // First number on a line, or `fallback` if there is none
+    int readNumber(int fallback = -1) {
+        string line = readLine();
+        char* end = nullptr;
+        long value = strtol(line.c_str(), &end, 10);
+        return end == line.c_str() ? fallback : (int)value;
     }
-    
-    bool isTie() {
-        for (int i = 0; i < 9; i++) {
-            if (board[i] == ' ') return false;
-        }
-        return true;
+};
+
+TerminalInput terminal;
+
+void TerminalInput::restoreAtExit() { terminal.end(); }
+
+#ifndef _WIN32
+// Only async-signal-safe calls: put the saved settings back, then let the
+// signal do what it would have done. Ctrl-Z stops right here and re-arms raw
+// mode once the shell resumes the game.
+void TerminalInput::onSignal(int sig) {
+    int savedErrno = errno;
+    if (sig == SIGCONT) { // Also after SIGSTOP, which cannot be caught; the shell may have reset the terminal
+        if (terminal.raw) tcsetattr(STDIN_FILENO, TCSANOW, &terminal.rawMode);
+        errno = savedErrno;
+        return;
     }
-    
-    void displayWinner(char winner, string player1Name, string player2Name) {
-        clearScreen();
+    if (terminal.raw) tcsetattr(STDIN_FILENO, TCSANOW, &terminal.saved);
+    handle(sig, SIG_DFL);
+    sigset_t self;
+    sigemptyset(&self);
+    sigaddset(&self, sig);
+    pthread_sigmask(SIG_UNBLOCK, &self, nullptr);
+    raise(sig); // Fatal signals end the process here
+    // Only SIGTSTP gets this far: resumed, or ignored in an orphaned process group
+    handle(sig, onSignal);
+    if (terminal.raw) tcsetattr(STDIN_FILENO, TCSANOW, &terminal.rawMode);
+    errno = savedErrno;
+}
+#endif
+
+// Single key for "Press any key to continue"
+char getch_custom() {
+    terminal.markWaiting();
+    return (char)terminal.readKey(-1);
+}
+
+// Bitboard: bit i (0-8) = cell i, satu mask untuk X dan satu untuk O
+constexpr uint16_t FULL_BOARD = 0x1FF;
+constexpr uint16_t WIN_MASKS[8] = {
+    0x007, 0x038, 0x1C0, // rows
+    0x049, 0x092, 0x124, // columns
+    0x111, 0x054         // diagonals
+};
+
+constexpr bool hasLineMask(uint16_t mask) {
+    for (uint16_t line : WIN_MASKS) {
+        if ((mask & line) == line) return true;
+    }
+    return false;
+}
+
+constexpr int stoneCount(uint16_t mask) {
+#if defined(__GNUC__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= (uint16_t)(mask - 1)) count++;
+    return count;
+#endif
+}
+
+// Per-line occupancy counters: 2 bits per line, X in bits 0-15 and O in bits
+// 16-31. LINE_STEP[i] adds one stone to every line through cell i.
+// LINE_STEP.counts[mask] is the sum of the steps of every cell in `mask`, so
+// a board is rebuilt from its masks without replaying the stones.
+struct LineStepTable {
+    std::array<uint32_t, 9> step{};
+    std::array<uint32_t, FULL_BOARD + 1> counts{};
+    constexpr LineStepTable() {
+        for (int i = 0; i < 9; i++) {
+            for (int line = 0; line < 8; line++) {
+                if (WIN_MASKS[line] >> i & 1) step[i] |= 1u << (2 * line);
+            }
+        }
+        for (uint32_t mask = 0; mask <= FULL_BOARD; mask++) {
+            for (int i = 0; i < 9; i++) {
+                if (mask >> i & 1) counts[mask] += step[i];
+            }
+        }
+    }
+};
+constexpr LineStepTable LINE_STEP{};
+constexpr uint32_t LINE_LOW_BITS = 0x5555; // Low bit of each X counter
+
+// Per 9-bit stone mask: 1 if it contains a line. 512 bytes that stay in L1, so
+// the scalar kernel does two loads per position instead of sixteen compares.
+struct LineTable {
+    uint8_t hasLine[FULL_BOARD + 1] = {};
+
+    constexpr LineTable() {
+        for (uint32_t mask = 0; mask <= FULL_BOARD; mask++) hasLine[mask] = hasLineMask((uint16_t)mask) ? 1 : 0;
+    }
+};
+constexpr LineTable LINE_TABLE{};
+
+// Game rules on a plain value. GameState is just the two stone masks (4
+// bytes, no constructor, no heap), so callers that hold many games keep them
+// in flat arrays; side to move, move count and the result all follow from the
+// masks through the free functions below. They are the one copy of the 3x3
+// rules: BitBoard (the search board) adds incremental line counters on top,
+// and the batch classifier's scalar kernel is outcome() itself.
+enum GameOutcome : uint8_t { OUTCOME_ONGOING, OUTCOME_X_WINS, OUTCOME_O_WINS, OUTCOME_DRAW };
+
+struct GameState {
+    uint16_t x;
+    uint16_t o;
+};
+static_assert(sizeof(GameState) == 4, "GameState must stay four bytes");
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must be copyable with memcpy");
+
+constexpr GameState EMPTY_STATE = {0, 0};
+
+constexpr int movesPlayed(GameState s) { return stoneCount((uint16_t)(s.x | s.o)); }
+constexpr char sideToMove(GameState s) { return (movesPlayed(s) & 1) ? 'O' : 'X'; }
+
+constexpr char cellAt(GameState s, int cell) {
+    return (s.x >> cell & 1) ? 'X' : ((s.o >> cell & 1) ? 'O' : ' ');
+}
+
+constexpr GameOutcome outcome(GameState s) {
+    return LINE_TABLE.hasLine[s.x & FULL_BOARD] ? OUTCOME_X_WINS
+         : LINE_TABLE.hasLine[s.o & FULL_BOARD] ? OUTCOME_O_WINS
+         : (s.x | s.o) == FULL_BOARD ? OUTCOME_DRAW : OUTCOME_ONGOING;
+}
+
+// Empty cells as a mask; none once the game is over
+constexpr uint16_t legalMoves(GameState s) {
+    return outcome(s) == OUTCOME_ONGOING ? (uint16_t)(FULL_BOARD & ~(s.x | s.o)) : 0;
+}
+
+constexpr bool isLegalMove(GameState s, int cell) { return cell >= 0 && cell < 9 && (legalMoves(s) >> cell & 1); }
+
+// The side to move plays `cell` (the caller checks isLegalMove)
+constexpr GameState applyMove(GameState s, int cell) {
+    return sideToMove(s) == 'X' ? GameState{(uint16_t)(s.x | 1u << cell), s.o}
+                                : GameState{s.x, (uint16_t)(s.o | 1u << cell)};
+}
+
+static_assert(outcome(applyMove(applyMove(applyMove(applyMove(applyMove(EMPTY_STATE, 0), 3), 1), 4), 2)) == OUTCOME_X_WINS,
+              "Top row wins for X");
+static_assert(sideToMove(applyMove(EMPTY_STATE, 4)) == 'O' && legalMoves(applyMove(EMPTY_STATE, 4)) == 0x1EF,
+              "O replies to the center opening on any other cell");
+
+// Compact game state: one 9-bit occupancy mask per player, plus line counters
+// and a move count kept up to date by place/remove so winner() and isFull()
+// are O(1) right after a move.
+struct BitBoard {
+    static constexpr int CELLS = 9;
+    uint16_t x;
+    uint16_t o;
+    uint32_t lineCounts;
+    uint8_t moveCount;
+
+    BitBoard() : x(0), o(0), lineCounts(0), moveCount(0) {}
+
+    // O(1): the counters come straight from the masks
+    static BitBoard fromMasks(uint16_t xMask, uint16_t oMask) {
+        BitBoard b;
+        b.x = xMask & FULL_BOARD;
+        b.o = oMask & FULL_BOARD & ~b.x;
+        b.lineCounts = LINE_STEP.counts[b.x] + (LINE_STEP.counts[b.o] << 16);
+        b.moveCount = (uint8_t)movesPlayed(b.state());
+        return b;
+    }
+
+    GameState state() const { return GameState{x, o}; }
+
+    void clear() { x = o = 0; lineCounts = 0; moveCount = 0; }
+
+    uint16_t occupied() const { return x | o; }
+    uint16_t emptyMask() const { return FULL_BOARD & ~occupied(); }
+    bool isEmpty(int i) const { return !(occupied() >> i & 1); }
+
+    char at(int i) const { return cellAt(state(), i); }
+
+    void place(int i, char player) {
+        if (player == 'X') {
+            x |= (uint16_t)(1u << i);
+            lineCounts += LINE_STEP.step[i];
+        } else {
+            o |= (uint16_t)(1u << i);
+            lineCounts += LINE_STEP.step[i] << 16;
+        }
+        moveCount++;
+    }
+
+    void remove(int i) {
+        if (x >> i & 1) {
+            x &= (uint16_t)~(1u << i);
+            lineCounts -= LINE_STEP.step[i];
+        } else if (o >> i & 1) {
+            o &= (uint16_t)~(1u << i);
+            lineCounts -= LINE_STEP.step[i] << 16;
+        } else {
+            return;
+        }
+        moveCount--;
+    }
+
+    // Play/take back a move for whoever is on turn
+    void makeMove(int i) { place(i, sideToMove()); }
+    void unmakeMove(int i) { remove(i); }
+
+    // A counter of 3 (both bits set) is a completed line
+    char winner() const {
+        uint32_t full = lineCounts & (lineCounts >> 1);
+        if (full & LINE_LOW_BITS) return 'X';
+        if (full & (LINE_LOW_BITS << 16)) return 'O';
+        return ' ';
+    }
+
+    // Did the stone just placed on `cell` complete one of its lines?
+    bool winsAt(int cell, char player) const {
+        uint32_t full = lineCounts & (lineCounts >> 1);
+        return (full & (LINE_STEP.step[cell] << (player == 'X' ? 0 : 16))) != 0;
+    }
+
+    bool isFull() const { return moveCount == 9; }
+    bool isTerminal() const { return isFull() || winner() != ' '; }
+
+    // X always moves first
+    char sideToMove() const { return (moveCount & 1) ? 'O' : 'X'; }
+};
+
+inline GameState stateOf(const BitBoard& board) { return board.state(); }
+inline BitBoard toBitBoard(GameState s) { return BitBoard::fromMasks(s.x, s.o); }
+
+// Base-3 position index: cell i contributes 3^i for X and 2*3^i for O
+constexpr int POSITION_COUNT = 19683; // 3^9
+
+struct TernaryTable {
+    std::array<uint16_t, 512> weight{};
+    constexpr TernaryTable() {
+        for (int mask = 0; mask < 512; mask++) {
+            int value = 0, power = 1;
+            for (int i = 0; i < 9; i++) {
+                if (mask >> i & 1) value += power;
+                power *= 3;
+            }
+            weight[mask] = (uint16_t)value;
+        }
+    }
+};
+constexpr TernaryTable TERNARY{};
+
+constexpr int positionIndex(uint16_t x, uint16_t o) {
+    return TERNARY.weight[x] + 2 * TERNARY.weight[o];
+}
+
+// Search scores: a win is worth WIN_SCORE minus the plies it takes, so faster
+// wins (and slower losses) score better. Draws are 0.
+constexpr int WIN_SCORE = 10;
+constexpr int MOVE_ORDER[9] = {4, 0, 2, 6, 8, 1, 3, 5, 7}; // center, corners, sides
+
+// Perfect-play table solved at compile time. Each position stores the best move
+// (NO_MOVE if none) and its depth-aware score for the side to move.
+// Placing a stone only ever raises the index, so walking the indices downwards
+// guarantees every child has been solved before its parent.
+constexpr uint8_t NO_MOVE = 0x0F;
+
+struct PerfectPlayTable {
+    std::array<int8_t, POSITION_COUNT> scores{};
+    std::array<uint8_t, POSITION_COUNT> moves{};
+
+    constexpr PerfectPlayTable() {
+        for (int idx = POSITION_COUNT - 1; idx >= 0; idx--) {
+            uint16_t x = 0, o = 0;
+            int rest = idx, xCount = 0, oCount = 0;
+            for (int i = 0; i < 9; i++) {
+                int cell = rest % 3;
+                rest /= 3;
+                if (cell == 1) { x |= (uint16_t)(1u << i); xCount++; }
+                else if (cell == 2) { o |= (uint16_t)(1u << i); oCount++; }
+            }
+            moves[idx] = NO_MOVE;
+            scores[idx] = 0;
+            // Only X-first positions are legal; leave the rest as draws with no move
+            if (xCount != oCount && xCount != oCount + 1) continue;
+            if (hasLineMask(x) || hasLineMask(o)) { // Previous mover already won
+                scores[idx] = (int8_t)-WIN_SCORE;
+                continue;
+            }
+            if ((x | o) == FULL_BOARD) continue; // Tie
+            bool xToMove = (xCount == oCount);
+            int bestScore = -WIN_SCORE - 1, bestMove = NO_MOVE;
+            for (int i : MOVE_ORDER) {
+                if ((x | o) >> i & 1) continue;
+                int child = idx + (xToMove ? 1 : 2) * TERNARY.weight[1u << i];
+                int score = -scores[child];
+                score -= (score > 0) - (score < 0); // One ply further from the result
+                if (score > bestScore) { // First best in MOVE_ORDER, same as minimaxMove
+                    bestScore = score;
+                    bestMove = i;
+                }
+            }
+            scores[idx] = (int8_t)bestScore;
+            moves[idx] = (uint8_t)bestMove;
+        }
+    }
+
+    constexpr int bestMove(int idx) const { return moves[idx]; }
+    constexpr int score(int idx) const { return scores[idx]; }
+    constexpr int value(int idx) const { return (scores[idx] > 0) - (scores[idx] < 0); }
+};
+constexpr PerfectPlayTable PERFECT_PLAY{};
+
+static_assert(PERFECT_PLAY.value(0) == 0, "Perfect play from the empty board must be a draw");
+static_assert(PERFECT_PLAY.bestMove(0) == 4, "Perfect play opens in the center");
+static_assert(PERFECT_PLAY.score(positionIndex(0x003, 0x018)) == WIN_SCORE - 1, "X must take the immediate win");
+
+// ---------------------------------------------------------------------------
+// Batch position classifier over structure-of-arrays bitboards: x[i] and o[i]
+// are the masks of position i. Kernels test all eight lines with mask compares
+// on 8 (SSE2) or 32 (AVX2) positions at a time; the best one the CPU supports
+// is picked once at startup, with a scalar loop as the fallback and the tail.
+// ---------------------------------------------------------------------------
+
+typedef void (*ClassifyKernel)(const uint16_t* x, const uint16_t* o, uint8_t* out, size_t count);
+
+
+void classifyScalar(const uint16_t* x, const uint16_t* o, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) out[i] = outcome(GameState{x[i], o[i]});
+}
+
+#if SIMD_X86
+// 8 positions: 16-bit lanes, so every compare covers the whole batch
+void classifySse2(const uint16_t* x, const uint16_t* o, uint8_t* out, size_t count) {
+    const __m128i full = _mm_set1_epi16((short)FULL_BOARD);
+    __m128i lines[8];
+    for (int l = 0; l < 8; l++) lines[l] = _mm_set1_epi16((short)WIN_MASKS[l]);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        __m128i vo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(o + i));
+        __m128i xWins = _mm_setzero_si128(), oWins = _mm_setzero_si128();
+        for (const __m128i& line : lines) {
+            xWins = _mm_or_si128(xWins, _mm_cmpeq_epi16(_mm_and_si128(vx, line), line));
+            oWins = _mm_or_si128(oWins, _mm_cmpeq_epi16(_mm_and_si128(vo, line), line));
+        }
+        __m128i isFull = _mm_cmpeq_epi16(_mm_or_si128(vx, vo), full);
+        // X beats O beats draw: each class only where no earlier one applies
+        __m128i cls = _mm_and_si128(xWins, _mm_set1_epi16(OUTCOME_X_WINS));
+        cls = _mm_or_si128(cls, _mm_andnot_si128(xWins, _mm_and_si128(oWins, _mm_set1_epi16(OUTCOME_O_WINS))));
+        cls = _mm_or_si128(cls, _mm_andnot_si128(_mm_or_si128(xWins, oWins), _mm_and_si128(isFull, _mm_set1_epi16(OUTCOME_DRAW))));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(cls, cls));
+    }
+    classifyScalar(x + i, o + i, out + i, count - i);
+}
+#endif
+
+#if SIMD_AVX2
+// 32 positions: two 16-lane vectors, packed together into one 32-byte store
+__attribute__((target("avx2"))) inline __m256i classifyAvx2Lanes(__m256i vx, __m256i vo) {
+    __m256i xWins = _mm256_setzero_si256(), oWins = _mm256_setzero_si256();
+    for (uint16_t mask : WIN_MASKS) {
+        __m256i line = _mm256_set1_epi16((short)mask);
+        xWins = _mm256_or_si256(xWins, _mm256_cmpeq_epi16(_mm256_and_si256(vx, line), line));
+        oWins = _mm256_or_si256(oWins, _mm256_cmpeq_epi16(_mm256_and_si256(vo, line), line));
+    }
+    __m256i isFull = _mm256_cmpeq_epi16(_mm256_or_si256(vx, vo), _mm256_set1_epi16((short)FULL_BOARD));
+    __m256i cls = _mm256_and_si256(xWins, _mm256_set1_epi16(OUTCOME_X_WINS));
+    cls = _mm256_or_si256(cls, _mm256_andnot_si256(xWins, _mm256_and_si256(oWins, _mm256_set1_epi16(OUTCOME_O_WINS))));
+    return _mm256_or_si256(cls, _mm256_andnot_si256(_mm256_or_si256(xWins, oWins),
+                                                     _mm256_and_si256(isFull, _mm256_set1_epi16(OUTCOME_DRAW))));
+}
+
+__attribute__((target("avx2"))) void classifyAvx2(const uint16_t* x, const uint16_t* o, uint8_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i lo = classifyAvx2Lanes(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(o + i)));
+        __m256i hi = classifyAvx2Lanes(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + 16)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(o + i + 16)));
+        // packus works per 128-bit lane; the permute puts the 32 bytes back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    _mm256_zeroupper(); // Dirty upper halves would slow every SSE instruction that follows
+    classifySse2(x + i, o + i, out + i, count - i);
+}
+#endif
+
+struct ClassifierChoice {
+    const char* name;
+    ClassifyKernel kernel;
+};
+
+// Every kernel this build and CPU can run, best first
+vector<ClassifierChoice> availableClassifiers() {
+    vector<ClassifierChoice> kernels;
+#if SIMD_AVX2
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", classifyAvx2});
+#endif
+#if SIMD_X86
+    kernels.push_back({"sse2", classifySse2});
+#endif
+    kernels.push_back({"scalar", classifyScalar});
+    return kernels;
+}
+
+const ClassifierChoice& bestClassifier() {
+    static const ClassifierChoice choice = availableClassifiers().front();
+    return choice;
+}
+
+// out[i] receives the GameOutcome of (x[i], o[i])
+inline void classifyPositions(const uint16_t* x, const uint16_t* o, uint8_t* out, size_t count) {
+    bestClassifier().kernel(x, o, out, count);
+}
+
+// SplitMix64: small deterministic generator for hash keys
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// PCG32 (O'Neill): 64-bit state, 32-bit output. Each game owns one stream
+// seeded from a recordable 64-bit seed, so any game can be replayed exactly
+// and simulator threads never share generator state.
+struct GameRng {
+    uint64_t state;
+    uint64_t inc;
+
+    explicit GameRng(uint64_t seed = 0) { reseed(seed); }
+
+    void reseed(uint64_t seed) {
+        state = splitMix64(seed);
+        inc = splitMix64(seed) | 1;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    uint64_t next64() { return (uint64_t)next() << 32 | next(); }
+
+    // Uniform in [0, n) by multiply-shift; bias is below n / 2^32
+    uint32_t below(uint32_t n) { return (uint32_t)(((uint64_t)next() * n) >> 32); }
+};
+
+// Zobrist keys for an N x N board plus the 8 rotations/reflections (D4 group).
+// transform[s][cell] is where `cell` lands under symmetry s.
+template <int N>
+struct SymmetricZobrist {
+    static constexpr int CELLS = N * N;
+    uint64_t pieceKey[2][CELLS]; // [0] = X, [1] = O
+    uint64_t sideKey;            // XORed in when O is to move
+    uint8_t transform[8][CELLS];
+
+    explicit SymmetricZobrist(uint64_t seed) {
+        for (int p = 0; p < 2; p++) {
+            for (int c = 0; c < CELLS; c++) pieceKey[p][c] = splitMix64(seed);
+        }
+        sideKey = splitMix64(seed);
+        for (int c = 0; c < CELLS; c++) {
+            int r = c / N, col = c % N, m = N - 1;
+            int mapped[8] = {
+                r * N + col,                 // identity
+                col * N + (m - r),           // rotate 90
+                (m - r) * N + (m - col),     // rotate 180
+                (m - col) * N + r,           // rotate 270
+                r * N + (m - col),           // mirror horizontally
+                (m - r) * N + col,           // mirror vertically
+                col * N + r,                 // main diagonal
+                (m - col) * N + (m - r)      // anti diagonal
+            };
+            for (int sym = 0; sym < 8; sym++) transform[sym][c] = (uint8_t)mapped[sym];
+        }
+    }
+};
+
+// One incremental hash per symmetry; the smallest is the canonical key, so all
+// eight equivalent boards share one transposition table slot.
+template <int N>
+struct SymmetricHash {
+    const SymmetricZobrist<N>* keys;
+    uint64_t h[8];
+
+    explicit SymmetricHash(const SymmetricZobrist<N>& z) : keys(&z) { reset(); }
+
+    void reset() {
+        for (int sym = 0; sym < 8; sym++) h[sym] = 0;
+    }
+
+    // Place or remove a stone (XOR is its own inverse)
+    void toggle(int cell, char player) {
+        int p = (player == 'X' ? 0 : 1);
+        for (int sym = 0; sym < 8; sym++) h[sym] ^= keys->pieceKey[p][keys->transform[sym][cell]];
+    }
+
+    uint64_t canonical(char toMove) const {
+        uint64_t best = h[0];
+        for (int sym = 1; sym < 8; sym++) best = min(best, h[sym]);
+        return toMove == 'O' ? best ^ keys->sideKey : best;
+    }
+
+    // The symmetry that maps the board onto its canonical orientation
+    int canonicalSymmetry() const {
+        int best = 0;
+        for (int sym = 1; sym < 8; sym++) {
+            if (h[sym] < h[best]) best = sym;
+        }
+        return best;
+    }
+};
+
+const SymmetricZobrist<3> ZOBRIST_3X3(0x5EED0F7AC7AC70EULL);
+
+// Fixed-size, always-replace transposition table keyed by a 64-bit hash.
+// Alpha-beta results are stored with the kind of bound they represent and the
+// remaining depth they were searched to (0 for exhaustive 3x3 searches).
+enum BoundType : uint8_t { BOUND_EXACT, BOUND_LOWER, BOUND_UPPER };
+
+class TranspositionTable {
+private:
+    struct Entry {
+        uint64_t key;
+        int32_t score;
+        uint8_t bound;
+        uint8_t depth;
+        uint16_t generation; // Entry is live only if it matches the table's
+    };
+    vector<Entry> entries;
+    uint64_t mask;
+    uint16_t generation;
+
+public:
+    uint64_t hits, misses, stores;
+
+    explicit TranspositionTable(int log2Size = 16)
+        : entries(size_t(1) << log2Size, Entry{0, 0, BOUND_EXACT, 0, 0}), mask((uint64_t(1) << log2Size) - 1),
+          generation(1), hits(0), misses(0), stores(0) {}
+
+    // O(1): bumping the generation invalidates every entry at once
+    void clear() {
+        if (++generation == 0) {
+            for (Entry& e : entries) e.generation = 0;
+            generation = 1;
+        }
+        hits = misses = stores = 0;
+    }
+
+    bool probe(uint64_t key, int& score, uint8_t& bound, int& depth) {
+        const Entry& e = entries[key & mask];
+        if (e.generation == generation && e.key == key) {
+            hits++;
+            score = e.score;
+            bound = e.bound;
+            depth = e.depth;
+            return true;
+        }
+        misses++;
+        return false;
+    }
+
+    void store(uint64_t key, int score, uint8_t bound, int depth = 0) {
+        entries[key & mask] = Entry{key, (int32_t)score, bound, (uint8_t)depth, generation};
+        stores++;
+    }
+
+    double hitRate() const {
+        return (hits + misses) > 0 ? (double)hits / (hits + misses) * 100 : 0.0;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// N x N, k-in-a-row boards (4x4, 5x5, gomoku) and their search engine
+// ---------------------------------------------------------------------------
+
+template <int N, int K>
+struct GridBoard {
+    static constexpr int CELLS = N * N;
+    static_assert(K <= N, "Line length cannot exceed the board size");
+    std::bitset<CELLS> x, o;
+    int moveCount;
+
+    GridBoard() : moveCount(0) {}
+
+    void clear() { x.reset(); o.reset(); moveCount = 0; }
+    bool isEmpty(int i) const { return !x[i] && !o[i]; }
+    bool isFull() const { return moveCount == CELLS; }
+
+    char at(int i) const {
+        if (x[i]) return 'X';
+        if (o[i]) return 'O';
+        return ' ';
+    }
+
+    void place(int i, char player) {
+        (player == 'X' ? x : o).set(i);
+        moveCount++;
+    }
+
+    void remove(int i) {
+        x.reset(i);
+        o.reset(i);
+        moveCount--;
+    }
+
+    // Only lines through the last move can have been completed by it
+    bool winsAt(int cell, char player) const {
+        const std::bitset<CELLS>& stones = (player == 'X' ? x : o);
+        static const int dirs[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+        int r0 = cell / N, c0 = cell % N;
+        for (const auto& d : dirs) {
+            int run = 1;
+            for (int sign = -1; sign <= 1; sign += 2) {
+                int r = r0 + sign * d[0], c = c0 + sign * d[1];
+                while (r >= 0 && r < N && c >= 0 && c < N && stones[r * N + c]) {
+                    run++;
+                    r += sign * d[0];
+                    c += sign * d[1];
+                }
+            }
+            if (run >= K) return true;
+        }
+        return false;
+    }
+};
+
+// Iterative-deepening alpha-beta for GridBoard with a per-move time budget.
+// When the budget runs out the best move of the last finished iteration is
+// returned, so the caller never waits longer than the budget.
+template <int N, int K>
+class GridEngine {
+public:
+    static constexpr int CELLS = N * N;
+    static constexpr int GRID_WIN = 1000000;
+
+    struct SearchResult {
+        int move;
+        int score;
+        int depth;       // Deepest fully completed iteration
+        long long nodes;
+        double elapsedMs;
+        bool timedOut;
+    };
+
+    // Fixed per board size, so keys stay valid across runs (the opening book relies on it)
+    static const SymmetricZobrist<N>& zobrist() {
+        static const SymmetricZobrist<N> keys(0xB16B0A4DULL + N * 131 + K);
+        return keys;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    GridBoard<N, K>* board;
+    SymmetricHash<N> hash;
+    TranspositionTable table;
+    vector<std::array<int, K>> windows; // Every K-long line segment on the board
+    int history[2][CELLS];
+    long long nodes;
+    long long expanded; // Nodes whose moves were generated
+    Clock::time_point deadline;
+    const std::atomic<bool>* cancel; // Optional: stops the search early, e.g. when pondering is over
+    bool aborted;
+
+    // Sum of open windows: more own stones in a window the opponent has not
+    // touched scores exponentially higher. Returned for the side to move.
+    int evaluate(char mover) const {
+        static const int weight[6] = {0, 1, 8, 64, 512, 4096};
+        int score = 0;
+        for (const auto& w : windows) {
+            int cx = 0, co = 0;
+            for (int cell : w) {
+                cx += board->x[cell];
+                co += board->o[cell];
+            }
+            if (co == 0 && cx > 0) score += weight[min(cx, 5)];
+            else if (cx == 0 && co > 0) score -= weight[min(co, 5)];
+        }
+        return mover == 'X' ? score : -score;
+    }
+
+    // Small boards consider every empty cell; big boards only cells next to stones
+    int generateMoves(int ply, char mover, int moves[CELLS]) const {
+        int count = 0, keys[CELLS];
+        int radius = (N > 6) ? 1 : N;
+        int side = (mover == 'X' ? 0 : 1);
+        for (int i = 0; i < CELLS; i++) {
+            if (!board->isEmpty(i)) continue;
+            int r = i / N, c = i % N;
+            bool nearStone = (board->moveCount == 0 && r == N / 2 && c == N / 2) || radius >= N;
+            for (int dr = -radius; dr <= radius && !nearStone; dr++) {
+                for (int dc = -radius; dc <= radius && !nearStone; dc++) {
+                    int rr = r + dr, cc = c + dc;
+                    if (rr >= 0 && rr < N && cc >= 0 && cc < N && !board->isEmpty(rr * N + cc)) nearStone = true;
+                }
+            }
+            if (!nearStone) continue;
+            int centrality = N - abs(2 * r - (N - 1)) / 2 - abs(2 * c - (N - 1)) / 2;
+            int key = centrality + (ply > 0 ? history[side][i] * 4 : 0);
+            int pos = count++;
+            while (pos > 0 && keys[pos - 1] < key) {
+                keys[pos] = keys[pos - 1];
+                moves[pos] = moves[pos - 1];
+                pos--;
+            }
+            keys[pos] = key;
+            moves[pos] = i;
+        }
+        return count;
+    }
+
+    int search(int depth, int ply, int alpha, int beta, char mover, int lastMove) {
+        nodes++;
+        if ((nodes & 1023) == 0 && (Clock::now() >= deadline || (cancel && cancel->load(std::memory_order_relaxed)))) {
+            aborted = true;
+        }
+        if (aborted) return 0;
+
+        char other = (mover == 'X' ? 'O' : 'X');
+        if (lastMove >= 0 && board->winsAt(lastMove, other)) return -(GRID_WIN - ply);
+        if (board->isFull()) return 0;
+        if (depth == 0) return evaluate(mover);
+
+        uint64_t key = hash.canonical(mover);
+        int alphaOrig = alpha;
+        int cached, cachedDepth;
+        uint8_t bound;
+        if (table.probe(key, cached, bound, cachedDepth) && cachedDepth >= depth) {
+            int score = cached > GRID_WIN / 2 ? cached - ply : (cached < -GRID_WIN / 2 ? cached + ply : cached);
+            if (bound == BOUND_EXACT) return score;
+            if (bound == BOUND_LOWER) alpha = max(alpha, score);
+            else beta = min(beta, score);
+            if (alpha >= beta) return score;
+        }
+
+        int moves[CELLS];
+        int count = generateMoves(ply, mover, moves);
+        expanded++;
+        int bestScore = -GRID_WIN - 1;
+        for (int m = 0; m < count; m++) {
+            int i = moves[m];
+            board->place(i, mover);
+            hash.toggle(i, mover);
+            int score = -search(depth - 1, ply + 1, -beta, -alpha, other, i);
+            hash.toggle(i, mover);
+            board->remove(i);
+            if (aborted) return 0;
+            bestScore = max(bestScore, score);
+            alpha = max(alpha, score);
+            if (alpha >= beta) {
+                history[mover == 'X' ? 0 : 1][i] += depth * depth;
+                break;
+            }
+        }
+
+        bound = bestScore <= alphaOrig ? BOUND_UPPER : (bestScore >= beta ? BOUND_LOWER : BOUND_EXACT);
+        int stored = bestScore > GRID_WIN / 2 ? bestScore + ply : (bestScore < -GRID_WIN / 2 ? bestScore - ply : bestScore);
+        table.store(key, stored, bound, depth);
+        return bestScore;
+    }
+
+public:
+    GridEngine() : board(nullptr), hash(zobrist()), table(18), nodes(0), expanded(0), cancel(nullptr), aborted(false) {
+        static const int dirs[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+        for (int r = 0; r < N; r++) {
+            for (int c = 0; c < N; c++) {
+                for (const auto& d : dirs) {
+                    int endR = r + d[0] * (K - 1), endC = c + d[1] * (K - 1);
+                    if (endR < 0 || endR >= N || endC < 0 || endC >= N) continue;
+                    std::array<int, K> w;
+                    for (int k = 0; k < K; k++) w[k] = (r + d[0] * k) * N + (c + d[1] * k);
+                    windows.push_back(w);
+                }
+            }
+        }
+    }
+
+    SearchResult findBestMove(GridBoard<N, K>& position, char mover, int budgetMs, int maxDepth = CELLS,
+                              const std::atomic<bool>* stop = nullptr) {
+        Clock::time_point start = Clock::now();
+        deadline = start + std::chrono::milliseconds(budgetMs);
+        cancel = stop;
+        board = &position;
+        aborted = false;
+        nodes = 0;
+        expanded = 0;
+        uint64_t hitsBefore = table.hits, missesBefore = table.misses;
+        for (auto& side : history) for (int& h : side) h = 0;
+        hash.reset();
+        for (int i = 0; i < CELLS; i++) {
+            if (!position.isEmpty(i)) hash.toggle(i, position.at(i));
+        }
+
+        char other = (mover == 'X' ? 'O' : 'X');
+        int moves[CELLS];
+        int count = generateMoves(0, mover, moves);
+        SearchResult result{count > 0 ? moves[0] : -1, 0, 0, 0, 0.0, false};
+
+        for (int depth = 1; depth <= min(maxDepth, CELLS - position.moveCount) && count > 0; depth++) {
+            expanded++; // The root, once per iteration
+            int bestMove = -1, bestScore = -GRID_WIN - 1;
+            for (int m = 0; m < count; m++) {
+                int i = moves[m];
+                position.place(i, mover);
+                hash.toggle(i, mover);
+                int score = -search(depth - 1, 1, -GRID_WIN - 1, -bestScore, other, i);
+                hash.toggle(i, mover);
+                position.remove(i);
+                if (aborted) break;
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestMove = i;
+                }
+            }
+            if (aborted) {
+                result.timedOut = true;
+                break;
+            }
+            result.move = bestMove;
+            result.score = bestScore;
+            result.depth = depth;
+            // Try the previous best first in the next iteration
+            for (int m = 0; m < count; m++) {
+                if (moves[m] == bestMove) {
+                    std::rotate(moves, moves + m, moves + m + 1);
+                    break;
+                }
+            }
+            if (abs(bestScore) > GRID_WIN / 2) break; // Forced result found
+        }
+
+        result.nodes = nodes;
+        result.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        board = nullptr;
+        Metrics::add(COUNTER_SEARCHES);
+        Metrics::add(COUNTER_SEARCH_NODES, nodes);
+        Metrics::add(COUNTER_SEARCH_EXPANDED, expanded);
+        Metrics::add(COUNTER_TT_HITS, table.hits - hitsBefore);
+        Metrics::add(COUNTER_TT_MISSES, table.misses - missesBefore);
+        Metrics::record(HIST_SEARCH_DEPTH, result.depth);
+        return result;
+    }
+};
+
+// Same candidate rule as the engine: every empty cell on small boards, cells
+// next to a stone (or the center of an empty board) on big ones
+template <int N, int K>
+bool isCandidateMove(const GridBoard<N, K>& board, int cell) {
+    if (!board.isEmpty(cell)) return false;
+    if (N <= 6) return true;
+    int r = cell / N, c = cell % N;
+    if (board.moveCount == 0) return r == N / 2 && c == N / 2;
+    for (int dr = -1; dr <= 1; dr++) {
+        for (int dc = -1; dc <= 1; dc++) {
+            int rr = r + dr, cc = c + dc;
+            if (rr >= 0 && rr < N && cc >= 0 && cc < N && !board.isEmpty(rr * N + cc)) return true;
+        }
+    }
+    return false;
+}
+
+// Board sizes offered in the Big Board mode, compiled once each
+template class GridEngine<4, 4>;
+template class GridEngine<5, 4>;
+template class GridEngine<15, 5>;
+
+// ---------------------------------------------------------------------------
+// Ultimate Tic-Tac-Toe: nine 3x3 sub-boards. Playing cell c of a sub-board
+// sends the opponent to sub-board c; if that one is already won or full, the
+// opponent may play in any open sub-board. Three won sub-boards in a row win.
+// A move is encoded as subBoard * 9 + cell.
+// ---------------------------------------------------------------------------
+
+struct UltimateBoard {
+    BitBoard cells[9];  // One BitBoard per sub-board
+    BitBoard macro;     // Won sub-boards, as stones on the big board
+    uint16_t closed;    // Sub-boards that are won or full
+    int8_t forced;      // Sub-board the mover must play in, -1 = any open one
+    char toMove;
+
+    UltimateBoard() { clear(); }
+
+    void clear() {
+        for (BitBoard& b : cells) b.clear();
+        macro.clear();
+        closed = 0;
+        forced = -1;
+        toMove = 'X';
+    }
+
+    bool isLegal(int move) const {
+        if (move < 0 || move >= 81) return false;
+        int b = move / 9;
+        return !(closed >> b & 1) && (forced < 0 || forced == b) && cells[b].isEmpty(move % 9);
+    }
+
+    int legalMoves(int moves[81]) const {
+        int count = 0;
+        for (int b = 0; b < 9; b++) {
+            if ((closed >> b & 1) || (forced >= 0 && forced != b)) continue;
+            for (int c = 0; c < 9; c++) {
+                if (cells[b].isEmpty(c)) moves[count++] = b * 9 + c;
+            }
+        }
+        return count;
+    }
+
+    void play(int move) {
+        int b = move / 9, c = move % 9;
+        cells[b].place(c, toMove);
+        if (cells[b].winner() != ' ') {
+            macro.place(b, toMove);
+            closed |= (uint16_t)(1u << b);
+        } else if (cells[b].isFull()) {
+            closed |= (uint16_t)(1u << b);
+        }
+        forced = (closed >> c & 1) ? -1 : (int8_t)c;
+        toMove = (toMove == 'X' ? 'O' : 'X');
+    }
+
+    char winner() const { return macro.winner(); }
+    bool isOver() const { return winner() != ' ' || closed == FULL_BOARD; }
+};
+
+// Parallel Monte Carlo Tree Search for Ultimate Tic-Tac-Toe. Every thread runs
+// select/expand/playout/backpropagate on one shared tree until the time budget
+// runs out. Nodes live in a pool allocated once; visit and win counters are
+// atomics, and a thread bumps `visits` on the way down so the node looks like
+// a loss (virtual loss) and other threads spread out to different lines until
+// the real result is added on the way back up.
+class UltimateMcts {
+public:
+    struct SearchResult {
+        int move;
+        long long playouts;
+        int threads;
+        double elapsedMs;
+        double winRate; // Of the chosen move, for the side to move
+    };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr int32_t UNEXPANDED = -1;
+    static constexpr int32_t EXPANDING = -2;  // Another thread is creating the children
+    static constexpr int32_t POOL_FULL = -3;  // Stays a leaf for the rest of the search
+    static constexpr int32_t EXPAND_AFTER = 4; // Visits before a leaf grows children
+    static constexpr double EXPLORATION = 1.0;
+
+    struct Node {
+        std::atomic<int32_t> visits;     // Includes virtual losses still in flight
+        std::atomic<int32_t> wins;       // 2 per win, 1 per draw, for the player who made `move`
+        std::atomic<int32_t> firstChild; // Index into the pool, or one of the states above
+        uint8_t childCount;
+        uint8_t move;
+    };
+
+    vector<Node> nodes;
+    std::atomic<int32_t> nodeCount;
+    int threadCount;
+
+    void initNode(int32_t index, int move) {
+        Node& n = nodes[index];
+        n.visits.store(0, std::memory_order_relaxed);
+        n.wins.store(0, std::memory_order_relaxed);
+        n.firstChild.store(UNEXPANDED, std::memory_order_relaxed);
+        n.childCount = 0;
+        n.move = (uint8_t)move;
+    }
+
+    // Only the thread that wins the CAS creates the children; the others carry
+    // on with a playout from this node instead of waiting.
+    int32_t expand(int32_t index, const UltimateBoard& state) {
+        Node& n = nodes[index];
+        int32_t expected = UNEXPANDED;
+        if (!n.firstChild.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire)) return expected;
+        int moves[81];
+        int count = state.legalMoves(moves);
+        int32_t first = nodeCount.fetch_add(count, std::memory_order_relaxed);
+        if (first + count > (int32_t)nodes.size()) {
+            n.firstChild.store(POOL_FULL, std::memory_order_release);
+            return POOL_FULL;
+        }
+        for (int k = 0; k < count; k++) initNode(first + k, moves[k]);
+        n.childCount = (uint8_t)count;
+        n.firstChild.store(first, std::memory_order_release); // Publishes the children
+        return first;
+    }
+
+    // UCT; unvisited children first
+    int32_t select(int32_t index, int32_t first) const {
+        const Node& n = nodes[index];
+        double logVisits = log((double)max(n.visits.load(std::memory_order_relaxed), 1));
+        int32_t best = first;
+        double bestScore = -1.0;
+        for (int k = 0; k < n.childCount; k++) {
+            const Node& child = nodes[first + k];
+            int32_t visits = child.visits.load(std::memory_order_relaxed);
+            if (visits == 0) return first + k;
+            double score = child.wins.load(std::memory_order_relaxed) / (2.0 * visits) +
+                           EXPLORATION * sqrt(logVisits / visits);
+            if (score > bestScore) {
+                bestScore = score;
+                best = first + k;
+            }
+        }
+        return best;
+    }
+
+    static char playout(UltimateBoard& state, GameRng& rng) {
+        int moves[81];
+        while (!state.isOver()) {
+            int count = state.legalMoves(moves);
+            state.play(moves[rng.below((uint32_t)count)]);
+        }
+        return state.winner();
+    }
+
+    long long worker(const UltimateBoard& root, uint64_t seed, Clock::time_point deadline) {
+        GameRng rng(seed);
+        int32_t path[82];
+        char rootMover = root.toMove;
+        long long playouts = 0;
+        while ((playouts & 7) != 0 || Clock::now() < deadline) {
+            UltimateBoard state = root;
+            int32_t index = 0;
+            int depth = 0;
+            path[depth++] = 0;
+            nodes[0].visits.fetch_add(1, std::memory_order_relaxed);
+            while (!state.isOver()) {
+                int32_t first = nodes[index].firstChild.load(std::memory_order_acquire);
+                if (first == UNEXPANDED && nodes[index].visits.load(std::memory_order_relaxed) > EXPAND_AFTER) {
+                    first = expand(index, state);
+                }
+                if (first < 0) break;
+                index = select(index, first);
+                state.play(nodes[index].move);
+                nodes[index].visits.fetch_add(1, std::memory_order_relaxed); // Virtual loss
+                path[depth++] = index;
+            }
+            char winner = playout(state, rng);
+            // Odd depths were played by the root's side to move
+            for (int d = 1; d < depth; d++) {
+                char mover = (d % 2 == 1) ? rootMover : (rootMover == 'X' ? 'O' : 'X');
+                int result = (winner == ' ') ? 1 : (winner == mover ? 2 : 0);
+                nodes[path[d]].wins.fetch_add(result, std::memory_order_relaxed);
+            }
+            playouts++;
+        }
+        Metrics::add(COUNTER_MCTS_PLAYOUTS, playouts);
+        return playouts;
+    }
+
+public:
+    explicit UltimateMcts(int threads = 0, size_t nodeCapacity = 1 << 21)
+        : nodes(nodeCapacity), nodeCount(0),
+          threadCount(threads > 0 ? threads : max(1, (int)std::thread::hardware_concurrency())) {}
+
+    int threads() const { return threadCount; }
+
+    SearchResult findBestMove(const UltimateBoard& position, int budgetMs, uint64_t seed) {
+        Clock::time_point start = Clock::now();
+        Clock::time_point deadline = start + std::chrono::milliseconds(budgetMs);
+        nodeCount.store(1, std::memory_order_relaxed);
+        initNode(0, 0);
+        expand(0, position);
+
+        vector<long long> playouts(threadCount, 0);
+        vector<std::thread> helpers;
+        for (int t = 1; t < threadCount; t++) {
+            helpers.emplace_back([&, t] { playouts[t] = worker(position, seed + t, deadline); });
+        }
+        playouts[0] = worker(position, seed, deadline);
+        for (std::thread& helper : helpers) helper.join();
+
+        // Most visited child is the most robust choice
+        SearchResult result{-1, 0, threadCount, 0.0, 0.0};
+        int32_t first = nodes[0].firstChild.load(std::memory_order_acquire);
+        int32_t bestVisits = -1;
+        for (int k = 0; first >= 0 && k < nodes[0].childCount; k++) {
+            const Node& child = nodes[first + k];
+            int32_t visits = child.visits.load(std::memory_order_relaxed);
+            if (visits > bestVisits) {
+                bestVisits = visits;
+                result.move = child.move;
+                result.winRate = visits > 0 ? child.wins.load(std::memory_order_relaxed) / (2.0 * visits) : 0.0;
+            }
+        }
+        for (long long p : playouts) result.playouts += p;
+        result.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return result;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// AI move selection without any I/O, shared by the UI and the simulator
+// ---------------------------------------------------------------------------
+
+int findWinningMove(const BitBoard& board, char player) {
+    uint16_t stones = (player == 'X' ? board.x : board.o);
+    for (int i = 0; i < 9; i++) {
+        if (board.isEmpty(i) && hasLineMask((uint16_t)(stones | 1u << i))) return i;
+    }
+    return -1;
+}
+
+// Uniform pick from the empty cells; one draw no matter how full the board is
+// For every 9-bit mask of empty cells: how many there are and which, in
+// ascending order. Picking a random empty cell is then free of branches.
+struct EmptyCellTable {
+    struct Entry {
+        uint8_t count;
+        uint8_t cells[9];
+    };
+    Entry entries[FULL_BOARD + 1] = {};
+
+    constexpr EmptyCellTable() {
+        for (uint32_t mask = 0; mask <= FULL_BOARD; mask++) {
+            for (int i = 0; i < 9; i++) {
+                if (mask >> i & 1) entries[mask].cells[entries[mask].count++] = (uint8_t)i;
+            }
+        }
+    }
+};
+constexpr EmptyCellTable EMPTY_CELLS{};
+
+int randomEmptyCell(const BitBoard& board, GameRng& rng) {
+    const EmptyCellTable::Entry& empty = EMPTY_CELLS.entries[~(board.x | board.o) & FULL_BOARD];
+    return empty.cells[rng.below(empty.count)];
+}
+
+// ---------------------------------------------------------------------------
+// Learned 3x3 policy: Q(position, move) in [-1, 1] for the side to move,
+// trained by parallel self-play (--train) and stored as one int8 per cell.
+// The trainer only enables it for Medium or Hard when, at that level's
+// temperature, it reaches the level's strength target against Easy and
+// Impossible; otherwise the hand-written rules stay in charge.
+// ---------------------------------------------------------------------------
+
+const char* const POLICY_FILE = "tictactoe_policy_3x3.dat";
+
+// Default softmax temperature per difficulty (only Medium and Hard use the
+// policy); lower plays closer to the best move. --train can override them
+// and stores the ones it used in the file.
+const double POLICY_TEMPERATURE[5] = {0, 0, 0.35, 0.1, 0};
+
+// Strength a level's policy must reach (% of games as the tested side) to
+// replace its rules: wins against Easy and draws against Impossible
+const double POLICY_MIN_EASY_WINS[5] = {0, 0, 70, 80, 0};
+const double POLICY_MIN_IMPOSSIBLE_DRAWS[5] = {0, 0, 60, 99, 0};
+
+class LearnedPolicy {
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t positions;
+        uint64_t episodes;
+        float temperature[5]; // Per difficulty
+        uint8_t levels;       // Bit d set: difficulty d plays the policy
+        uint8_t reserved[19];
+    };
+    static_assert(sizeof(Header) == 64, "Header must stay 64 bytes");
+
+    vector<int8_t> q; // positions * 9, NO_VALUE for occupied cells
+
+public:
+    static constexpr int8_t NO_VALUE = -128;
+    static constexpr int VERSION = 2;
+    uint64_t episodes = 0;
+    double temperature[5] = {POLICY_TEMPERATURE[0], POLICY_TEMPERATURE[1], POLICY_TEMPERATURE[2], POLICY_TEMPERATURE[3],
+                             POLICY_TEMPERATURE[4]};
+    uint8_t levels = 0;
+
+    bool isLoaded() const { return !q.empty(); }
+
+    // Whether `difficulty` should play the policy instead of its rules
+    bool plays(int difficulty) const { return isLoaded() && difficulty >= 0 && difficulty < 5 && (levels >> difficulty & 1); }
+
+    void assign(vector<int8_t> values, uint64_t trainedEpisodes) {
+        q = std::move(values);
+        episodes = trainedEpisodes;
+    }
+
+    int value(int idx, int cell) const { return q[(size_t)idx * 9 + cell]; }
+
+    // A missing or mismatched file is not an error: the hand-written levels play
+    bool load(const string& path) {
+        q.clear();
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in) return false;
+        Header header;
+        vector<int8_t> values((size_t)POSITION_COUNT * 9);
+        bool ok = fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, "TTTPLCY", 8) == 0 &&
+                  header.version == VERSION && header.positions == (uint32_t)POSITION_COUNT &&
+                  fread(values.data(), 1, values.size(), in) == values.size();
+        fclose(in);
+        if (!ok) return false;
+        assign(std::move(values), header.episodes);
+        for (int d = 0; d < 5; d++) temperature[d] = header.temperature[d];
+        levels = header.levels;
+        return true;
+    }
+
+    bool save(const string& path) const {
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) return false;
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "TTTPLCY", 8);
+        header.version = VERSION;
+        header.positions = (uint32_t)POSITION_COUNT;
+        header.episodes = episodes;
+        for (int d = 0; d < 5; d++) header.temperature[d] = (float)temperature[d];
+        header.levels = levels;
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(q.data(), 1, q.size(), out) == q.size();
+        return fclose(out) == 0 && ok;
+    }
+
+    // Softmax over the empty cells at `temperature` (0 = best move): at most
+    // nine candidates, so constant time per move
+    int chooseMove(const BitBoard& board, double temperature, GameRng& rng) const {
+        int idx = positionIndex(board.x, board.o);
+        int best = -1;
+        for (int i : MOVE_ORDER) {
+            if (board.isEmpty(i) && (best < 0 || value(idx, i) > value(idx, best))) best = i;
+        }
+        if (temperature <= 0 || best < 0) return best;
+        double weights[9], total = 0;
+        for (int i = 0; i < 9; i++) {
+            weights[i] = board.isEmpty(i) ? exp((value(idx, i) - value(idx, best)) / (127.0 * temperature)) : 0.0;
+            total += weights[i];
+        }
+        double pick = rng.next() / 4294967296.0 * total;
+        for (int i = 0; i < 9; i++) {
+            if (weights[i] == 0.0) continue;
+            if (pick < weights[i]) return i;
+            pick -= weights[i];
+        }
+        return best;
+    }
+};
+
+// The policy file as of the first call, shared by the game, the simulator
+// and the server so every path plays the same Medium and Hard
+const LearnedPolicy& installedPolicy() {
+    static const LearnedPolicy policy = []() {
+        LearnedPolicy loaded;
+        loaded.load(POLICY_FILE);
+        return loaded;
+    }();
+    return policy;
+}
+
+int chooseAiMove(const BitBoard& board, char computer, char player, int difficulty, GameRng& rng,
+                 const LearnedPolicy* policy = nullptr) {
+    int choice = -1;
+    
+    if (policy && policy->plays(difficulty)) {
+        return policy->chooseMove(board, policy->temperature[difficulty], rng);
+    }
+    
+    switch (difficulty) {
+        case 1: // Easy - Random
+            choice = randomEmptyCell(board, rng);
+            break;
+            
+        case 2: // Medium - Win if possible, then block, then take center/corner, then random
+            choice = findWinningMove(board, computer); // Try to win
+            if (choice == -1) {
+                choice = findWinningMove(board, player); // Try to block
+            }
+            if (choice == -1) { // If no immediate win or block, take center or corner
+                if (board.isEmpty(4)) choice = 4; // Take center
+                else if (board.isEmpty(0)) choice = 0;
+                else if (board.isEmpty(2)) choice = 2;
+                else if (board.isEmpty(6)) choice = 6;
+                else if (board.isEmpty(8)) choice = 8;
+            }
+            if (choice == -1) { // Fallback to random
+                choice = randomEmptyCell(board, rng);
+            }
+            break;
+            
+        case 3: // Hard - Win or block, then strategic moves
+            choice = findWinningMove(board, computer); // Try to win
+            if (choice == -1) choice = findWinningMove(board, player); // Try to block
+            if (choice == -1) { // If no immediate win or block, apply strategy
+                // Take center if available
+                if (board.isEmpty(4)) choice = 4;
+                // Take opposite corner if player took a corner
+                else if (board.at(0) == player && board.isEmpty(8)) choice = 8;
+                else if (board.at(2) == player && board.isEmpty(6)) choice = 6;
+                else if (board.at(6) == player && board.isEmpty(2)) choice = 2;
+                else if (board.at(8) == player && board.isEmpty(0)) choice = 0;
+                // Take any available corner
+                else if (board.isEmpty(0)) choice = 0;
+                else if (board.isEmpty(2)) choice = 2;
+                else if (board.isEmpty(6)) choice = 6;
+                else if (board.isEmpty(8)) choice = 8;
+                // Take any available side
+                else if (board.isEmpty(1)) choice = 1;
+                else if (board.isEmpty(3)) choice = 3;
+                else if (board.isEmpty(5)) choice = 5;
+                else if (board.isEmpty(7)) choice = 7;
+            }
+            if (choice == -1) { // Fallback to random (shouldn't happen often in Hard)
+                choice = randomEmptyCell(board, rng);
+            }
+            break;
+            
+        case 4: // Impossible - Precomputed perfect play
+            choice = PERFECT_PLAY.bestMove(positionIndex(board.x, board.o));
+            break;
+    }
+    
+    return choice;
+}
+
+// Benchmark corpora: non-terminal positions from seeded random games, bucketed
+// by stones on the board (opening 0-2, midgame 3-5, near-terminal 6-8)
+struct BenchCorpus {
+    const char* name;
+    vector<BitBoard> positions;
+};
+
+vector<BenchCorpus> buildBenchCorpora(uint64_t seed, size_t perCorpus) {
+    vector<BenchCorpus> corpora = {{"opening", {}}, {"midgame", {}}, {"near-terminal", {}}};
+    GameRng rng(seed);
+    while (corpora[0].positions.size() < perCorpus || corpora[1].positions.size() < perCorpus ||
+           corpora[2].positions.size() < perCorpus) {
+        BitBoard board;
+        char turn = 'X';
+        for (int ply = 0; ply < 9; ply++) {
+            vector<BitBoard>& bucket = corpora[ply / 3].positions;
+            if (bucket.size() < perCorpus) bucket.push_back(board);
+            board.place(randomEmptyCell(board, rng), turn);
+            if (board.winner() != ' ') break;
+            turn = (turn == 'X' ? 'O' : 'X');
+        }
+    }
+    return corpora;
+}
+
+// Frame renderer: a whole screen is composed into `canvas` with the usual color
+// macros, parsed into styled cells and diffed against the previous frame. Only
+// changed cells (plus the escapes to reach and color them) go out, in a single
+// write. invalidate() forces the next frame to be drawn in full.
+class FrameRenderer {
+private:
+    // Style packs bold (bit 0), underline (bit 1), foreground (bits 2-5,
+    // 0 = default, 1-8 = SGR 30-37) and background (bits 6-9, same for 40-47)
+    struct Cell {
+        char ch;
+        uint16_t style;
+        bool operator==(const Cell& other) const { return ch == other.ch && style == other.style; }
+    };
+    vector<vector<Cell>> previous;
+    bool valid;
+
+    static uint16_t applySgr(uint16_t style, int code) {
+        if (code == 0) return 0;
+        if (code == 1) return style | 1;
+        if (code == 4) return style | 2;
+        if (code >= 30 && code <= 37) return (uint16_t)((style & ~(0xF << 2)) | (code - 29) << 2);
+        if (code >= 40 && code <= 47) return (uint16_t)((style & ~(0xF << 6)) | (code - 39) << 6);
+        return style;
+    }
+
+    static string sgrFor(uint16_t style) {
+        string sgr = "\033[0";
+        if (style & 1) sgr += ";1";
+        if (style & 2) sgr += ";4";
+        if (style >> 2 & 0xF) sgr += ";" + to_string(29 + (style >> 2 & 0xF));
+        if (style >> 6 & 0xF) sgr += ";" + to_string(39 + (style >> 6 & 0xF));
+        return sgr + "m";
+    }
+
+    vector<vector<Cell>> parseCanvas() {
+        vector<vector<Cell>> rows(1);
+        string text = canvas.str();
+        uint16_t style = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (c == '\033' && i + 1 < text.size() && text[i + 1] == '[') {
+                size_t end = i + 2;
+                while (end < text.size() && !isalpha((unsigned char)text[end])) end++;
+                if (end < text.size() && text[end] == 'm') {
+                    int code = 0;
+                    for (size_t k = i + 2; k <= end; k++) {
+                        if (isdigit((unsigned char)text[k])) {
+                            code = code * 10 + (text[k] - '0');
+                        } else {
+                            style = applySgr(style, code);
+                            code = 0;
+                        }
+                    }
+                }
+                i = end; // Other control sequences have no place in a frame
+            } else if (c == '\n') {
+                rows.emplace_back();
+            } else if (c != '\r') {
+                rows.back().push_back(Cell{c, style});
+            }
+        }
+        if (rows.back().empty()) rows.pop_back();
+        return rows;
+    }
+
+public:
+    ostringstream canvas;
+    size_t lastBytes; // Bytes written by the last present()
+
+    FrameRenderer() : valid(false), lastBytes(0) {}
+
+    void invalidate() { valid = false; }
+
+    void present() {
+        MetricTimer rendering(HIST_RENDER_US);
+        vector<vector<Cell>> current = parseCanvas();
+        canvas.str("");
+        canvas.clear();
+
+        string out;
+        if (!valid) out += "\033[2J\033[H";
+        const Cell blank{' ', 0};
+        uint16_t emitted = 0;
+        out += RESET;
+        size_t rowCount = max(current.size(), valid ? previous.size() : 0);
+        for (size_t r = 0; r < rowCount; r++) {
+            size_t newLen = r < current.size() ? current[r].size() : 0;
+            size_t oldLen = (valid && r < previous.size()) ? previous[r].size() : 0;
+            int cursorCol = -1; // Column the terminal cursor sits at on this row, -1 if unknown
+            for (size_t c = 0; c < max(newLen, oldLen); c++) {
+                const Cell& now = c < newLen ? current[r][c] : blank;
+                const Cell& before = c < oldLen ? previous[r][c] : blank;
+                if (valid && now == before) continue;
+                if (cursorCol != (int)c) out += "\033[" + to_string(r + 1) + ";" + to_string(c + 1) + "H";
+                if (now.style != emitted) {
+                    out += sgrFor(now.style);
+                    emitted = now.style;
+                }
+                out += now.ch;
+                cursorCol = (int)c + 1;
+            }
+        }
+        // Park the cursor under the frame and drop whatever was typed below it
+        out += RESET;
+        out += "\033[" + to_string(current.size() + 1) + ";1H\033[J";
+
+        Metrics::add(COUNTER_FRAMES);
+        Metrics::add(COUNTER_FRAME_BYTES, out.size());
+        cout.flush();
+#ifdef _WIN32
+        fwrite(out.data(), 1, out.size(), stdout);
+        fflush(stdout);
+#else
+        size_t written = 0;
+        while (written < out.size()) {
+            ssize_t n = ::write(STDOUT_FILENO, out.data() + written, out.size() - written);
+            if (n <= 0) break;
+            written += (size_t)n;
+        }
+#endif
+        lastBytes = out.size();
+        previous.swap(current);
+        valid = true;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Game records and the persistent, memory-mapped game log
+// ---------------------------------------------------------------------------
+
+enum GameMode : uint8_t { MODE_VS_COMPUTER = 0, MODE_MULTIPLAYER = 1, MODE_BIG_BOARD = 2, MODE_ULTIMATE = 3 };
+enum GameResult : uint8_t { RESULT_TIE = 0, RESULT_X_WINS = 1, RESULT_O_WINS = 2 };
+
+// One finished game in 64 bytes. 3x3 moves are packed 4 bits each, first move
+// in the low nibble of moves[0]; big-board and ultimate games keep moveCount = 0.
+struct GameRecord {
+    int64_t timestamp;
+    uint64_t seed;      // AI stream seed for vs-computer and ultimate games, 0 otherwise
+    char playerX[18];
+    char playerO[18];
+    uint8_t mode;       // GameMode
+    uint8_t level;      // AI difficulty 1-4, board size for big boards, 0 otherwise (ultimate has one level)
+    uint8_t result;     // GameResult
+    uint8_t moveCount;
+    uint8_t moves[5];
+    uint8_t reserved[3];
+
+    void setPlayers(const string& x, const string& o) {
+        snprintf(playerX, sizeof(playerX), "%s", x.c_str());
+        snprintf(playerO, sizeof(playerO), "%s", o.c_str());
+    }
+
+    void addMove(int cell) {
+        if (moveCount >= 9) return;
+        moves[moveCount / 2] |= (uint8_t)((cell & 0x0F) << (moveCount % 2 * 4));
+        moveCount++;
+    }
+
+    int moveAt(int ply) const { return moves[ply / 2] >> (ply % 2 * 4) & 0x0F; }
+};
+static_assert(sizeof(GameRecord) == 64, "GameRecord must stay one cache line");
+
+const char* const GAME_LOG_FILE = "tictactoe_games.dat";
+const char* const PLAYERS_FILE = "tictactoe_players.dat"; // Registry snapshot, see PlayerRegistry
+
+// FNV-1a over a record's bytes: identifies the log a registry snapshot was taken from
+uint64_t recordFingerprint(const GameRecord& record) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&record);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < sizeof(record); i++) hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+// Append-only file: a 64-byte header with running totals, then fixed-size
+// records. The file is mapped, so opening it costs the same for ten games or
+// ten million, and readers index records directly without loading them.
+class GameLog {
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t count;
+        uint64_t xWins, oWins, ties;
+        uint8_t reserved[16];
+    };
+    static_assert(sizeof(Header) == 64, "Header must match the record size");
+
+    Header* header;
+    size_t mappedBytes;
+    bool readOnly; // Opened for analysis: never created, grown or written
+#ifdef _WIN32
+    HANDLE file, mapping;
+#else
+    int fd;
+#endif
+
+    GameRecord* records() const { return reinterpret_cast<GameRecord*>(header + 1); }
+    size_t capacity() const { return mappedBytes / sizeof(GameRecord) - 1; }
+
+    void unmap() {
+        if (!header) return;
+#ifdef _WIN32
+        UnmapViewOfFile(header);
+        CloseHandle(mapping);
+#else
+        munmap(header, mappedBytes);
+#endif
+        header = nullptr;
+    }
+
+    // Grows the file to `bytes` (if needed) and maps all of it
+    bool mapFile(size_t bytes) {
+        unmap();
+#ifdef _WIN32
+        LARGE_INTEGER size;
+        size.QuadPart = (LONGLONG)bytes;
+        mapping = CreateFileMappingA(file, nullptr, readOnly ? PAGE_READONLY : PAGE_READWRITE, size.HighPart, size.LowPart, nullptr);
+        if (!mapping) return false;
+        void* view = MapViewOfFile(mapping, readOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+        if (!view) {
+            CloseHandle(mapping);
+            return false;
+        }
+#else
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+        if ((size_t)st.st_size < bytes && (readOnly || ftruncate(fd, (off_t)bytes) != 0)) return false;
+        void* view = mmap(nullptr, bytes, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) return false;
+#endif
+        header = static_cast<Header*>(view);
+        mappedBytes = bytes;
+        return true;
+    }
+
+public:
+    GameLog() : header(nullptr), mappedBytes(0), readOnly(false),
+#ifdef _WIN32
+        file(INVALID_HANDLE_VALUE), mapping(nullptr) {}
+#else
+        fd(-1) {}
+#endif
+
+    ~GameLog() { close(); }
+
+    bool open(const string& path, bool forReading = false) {
+        close();
+        readOnly = forReading;
+        size_t existing = 0;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), readOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+                           readOnly ? FILE_SHARE_READ | FILE_SHARE_WRITE : FILE_SHARE_READ, nullptr,
+                           readOnly ? OPEN_EXISTING : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        existing = (size_t)size.QuadPart;
+#else
+        fd = readOnly ? ::open(path.c_str(), O_RDONLY) : ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+        existing = (size_t)st.st_size;
+#endif
+        size_t initial = readOnly ? existing : max(existing, sizeof(Header) + 1024 * sizeof(GameRecord));
+        if (existing % sizeof(GameRecord) != 0 || initial == 0 || !mapFile(initial)) {
+            close();
+            return false;
+        }
+        if (existing == 0) {
+            memset(header, 0, sizeof(Header));
+            memcpy(header->magic, "TTTLOG1", 8);
+            header->version = 1;
+            header->recordSize = sizeof(GameRecord);
+        } else if (memcmp(header->magic, "TTTLOG1", 8) != 0 || header->recordSize != sizeof(GameRecord) ||
+                   header->count > capacity()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        unmap();
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    uint64_t size() const { return header ? header->count : 0; }
+    uint64_t xWins() const { return header ? header->xWins : 0; }
+    uint64_t oWins() const { return header ? header->oWins : 0; }
+    uint64_t ties() const { return header ? header->ties : 0; }
+
+    // i = 0 is the oldest game
+    const GameRecord& at(uint64_t i) const { return records()[i]; }
+
+    bool append(const GameRecord& record) {
+        if (!header || readOnly) return false;
+        if (header->count == capacity() && !mapFile(mappedBytes * 2)) return false;
+        records()[header->count] = record;
+        header->count++; // Published only after the record itself is written
+        if (record.result == RESULT_X_WINS) header->xWins++;
+        else if (record.result == RESULT_O_WINS) header->oWins++;
+        else header->ties++;
+        return true;
+    }
+};
+
+// Human-readable line for one record, built only when it is shown
+string describeGameRecord(const GameRecord& record) {
+    time_t when = (time_t)record.timestamp;
+    string timestamp(ctime(&when));
+    timestamp.pop_back(); // Remove newline
+    string playerX(record.playerX, strnlen(record.playerX, sizeof(record.playerX)));
+    string playerO(record.playerO, strnlen(record.playerO, sizeof(record.playerO)));
+    string difficultyName[] = {"", "Easy", "Medium", "Hard", "Impossible"};
+    if (record.mode == MODE_VS_COMPUTER) {
+        playerO = "Computer (" + difficultyName[record.level % 5] + ", seed " + to_string(record.seed) + ")";
+    } else if (record.mode == MODE_BIG_BOARD) {
+        playerO = "Computer (" + to_string(record.level) + "x" + to_string(record.level) + ")";
+    } else if (record.mode == MODE_ULTIMATE) {
+        playerO = "Computer (Ultimate, seed " + to_string(record.seed) + ")";
+    }
+    string text;
+    if (record.result == RESULT_X_WINS) text = playerX + " defeated " + playerO;
+    else if (record.result == RESULT_O_WINS) text = playerO + " defeated " + playerX;
+    else text = "Tie: " + playerX + " vs " + playerO;
+    if (record.moveCount > 0) {
+        text += " | Moves:";
+        for (int ply = 0; ply < record.moveCount; ply++) {
+            text += string(" ") + (ply % 2 == 0 ? 'X' : 'O') + to_string(record.moveAt(ply) + 1);
+        }
+    }
+    return timestamp + " - " + text;
+}
+
+// Fixed-capacity ring buffer: storage is allocated once, push() is O(1) and
+// overwrites the oldest entry when full. Index 0 is the oldest element.
+template <typename T>
+class RingBuffer {
+private:
+    vector<T> slots;
+    size_t head;  // Next slot to write
+    size_t count;
+
+public:
+    explicit RingBuffer(size_t capacity) : slots(max<size_t>(capacity, 1)), head(0), count(0) {}
+
+    void push(const T& value) {
+        slots[head] = value;
+        head = (head + 1) % slots.size();
+        if (count < slots.size()) count++;
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+    bool empty() const { return count == 0; }
+    void clear() { head = count = 0; }
+
+    const T& operator[](size_t i) const { return slots[(head + slots.size() - count + i) % slots.size()]; }
+    const T& newest(size_t i = 0) const { return (*this)[count - 1 - i]; }
+};
+
+// ---------------------------------------------------------------------------
+// Opening/endgame book for the big boards, built offline by --build-book.
+// File: a 64-byte header, `count` sorted canonical keys, then one 4-byte entry
+// per key. The file is mapped read-only, so opening it costs nothing up
+// front; a probe is one interpolation search over the mapped keys, and only
+// the pages it touches are ever read from disk.
+// ---------------------------------------------------------------------------
+
+struct BookEntry {
+    int16_t value;  // For the side to move; +-BOOK_WIN minus plies for proven results
+    uint8_t move;   // In the canonical orientation of the position
+    uint8_t depth;  // Search depth that produced it, BOOK_SOLVED_DEPTH once solved
+};
+static_assert(sizeof(BookEntry) == 4, "BookEntry must stay 4 bytes");
+
+constexpr int BOOK_WIN = 30000;
+constexpr uint8_t BOOK_SOLVED_DEPTH = 255;
+// Version 2 books hold only solved entries or ones searched deeper than the
+// live engine gets within its move budget; older books are ignored
+constexpr uint32_t BOOK_VERSION = 2;
+
+// Computer's time per move on the big boards. The book builder searches at
+// least this long, so a book move is never weaker than a live search.
+constexpr int GRID_MOVE_BUDGET_MS = 1000;
+
+string openingBookPath(int n, int k) {
+    return "tictactoe_book_" + to_string(n) + "x" + to_string(n) + "k" + to_string(k) + ".dat";
+}
+
+class OpeningBook {
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t boardSize;
+        uint32_t lineLength;
+        uint32_t entrySize;
+        uint64_t count;
+        uint8_t reserved[32];
+    };
+    static_assert(sizeof(Header) == 64, "Header must stay 64 bytes");
+
+    const Header* header;
+    size_t mappedBytes;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+
+    const uint64_t* keys() const { return reinterpret_cast<const uint64_t*>(header + 1); }
+    const BookEntry* entries() const { return reinterpret_cast<const BookEntry*>(keys() + header->count); }
+
+public:
+    OpeningBook() : header(nullptr), mappedBytes(0)
+#ifdef _WIN32
+        , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+    {}
+
+    ~OpeningBook() { close(); }
+
+    // A missing or mismatched book is not an error: the engine just searches
+    bool open(const string& path, int n, int k) {
+        close();
+        void* view = nullptr;
+        size_t bytes = 0;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        bytes = (size_t)size.QuadPart;
+        if (bytes >= sizeof(Header)) mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Header)) {
+            bytes = (size_t)st.st_size;
+            view = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            if (view == MAP_FAILED) view = nullptr;
+        }
+        ::close(fd); // The mapping stays valid
+#endif
+        if (!view) {
+            close();
+            return false;
+        }
+        header = static_cast<const Header*>(view);
+        mappedBytes = bytes;
+        if (memcmp(header->magic, "TTTBOOK", 8) != 0 || header->version != BOOK_VERSION || header->boardSize != (uint32_t)n ||
+            header->lineLength != (uint32_t)k || header->entrySize != sizeof(BookEntry) ||
+            sizeof(Header) + header->count * (sizeof(uint64_t) + sizeof(BookEntry)) > bytes) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (header) UnmapViewOfFile(header);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (header) munmap(const_cast<Header*>(header), mappedBytes);
+#endif
+        header = nullptr;
+        mappedBytes = 0;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    uint64_t size() const { return header ? header->count : 0; }
+
+    // Keys are uniform hashes, so interpolation lands within a few slots of
+    // the target; the last stretch is a plain binary search.
+    const BookEntry* probe(uint64_t key) const {
+        if (!header || header->count == 0) return nullptr;
+        const uint64_t* k = keys();
+        uint64_t lo = 0, hi = header->count - 1;
+        while (hi - lo > 16) {
+            if (key < k[lo] || key > k[hi]) return nullptr;
+            double fraction = (double)(key - k[lo]) / (double)(k[hi] - k[lo]);
+            uint64_t mid = lo + (uint64_t)(fraction * (double)(hi - lo));
+            mid = min(max(mid, lo), hi);
+            if (k[mid] == key) return entries() + mid;
+            if (k[mid] < key) lo = mid + 1;
+            else hi = mid == 0 ? 0 : mid - 1;
+            if (lo > hi) return nullptr;
+        }
+        const uint64_t* found = std::lower_bound(k + lo, k + hi + 1, key);
+        return (found != k + hi + 1 && *found == key) ? entries() + (found - k) : nullptr;
+    }
+};
+
+// Looks `position` up in the book and maps the stored move back from the
+// canonical orientation. Returns -1 when the position is not in the book.
+template <int N, int K>
+int probeOpeningBook(const OpeningBook& book, const GridBoard<N, K>& position, char mover, int* value = nullptr,
+                     int* depth = nullptr) {
+    if (!book.isOpen()) return -1;
+    const SymmetricZobrist<N>& z = GridEngine<N, K>::zobrist();
+    SymmetricHash<N> hash(z);
+    for (int i = 0; i < N * N; i++) {
+        if (!position.isEmpty(i)) hash.toggle(i, position.at(i));
+    }
+    const BookEntry* entry = book.probe(hash.canonical(mover));
+    if (!entry) return -1;
+    int sym = hash.canonicalSymmetry();
+    for (int i = 0; i < N * N; i++) {
+        if (z.transform[sym][i] == entry->move) {
+            if (!position.isEmpty(i)) return -1; // Key collision
+            if (value) *value = entry->value;
+            if (depth) *depth = entry->depth;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Retrograde-solved tables for boards of up to 16 cells (4x4): win, draw or
+// loss for the side to move, 2 bits per base-3 position index, in a
+// memory-mapped file (tictactoe_solved_<N>x<N>k<K>.dat, 10.3 MB for 4x4).
+// Built by --solve one layer (stone count) at a time from the full board back
+// to the empty one; the header keeps the next layer to solve, so an
+// interrupted run resumes there. A finished table is a perfect-play oracle.
+// ---------------------------------------------------------------------------
+
+enum SolvedValue : uint8_t { SOLVED_UNKNOWN, SOLVED_WIN, SOLVED_DRAW, SOLVED_LOSS };
+
+string solvedTablePath(int n, int k) {
+    return "tictactoe_solved_" + to_string(n) + "x" + to_string(n) + "k" + to_string(k) + ".dat";
+}
+
+// Line masks and base-3 weights for an n x n board with n * n <= 16
+struct SolverGeometry {
+    int n, k, cells;
+    uint32_t positions;          // 3^cells
+    uint32_t power3[16];
+    vector<uint32_t> ternary;    // Base-3 value of every stone mask
+    vector<uint16_t> lines;      // Every k-long line
+
+    SolverGeometry(int size, int lineLength) : n(size), k(lineLength), cells(size * size), positions(1) {
+        for (int i = 0; i < cells; i++) {
+            power3[i] = positions;
+            positions *= 3;
+        }
+        ternary.assign(size_t(1) << cells, 0);
+        for (uint32_t mask = 1; mask < ternary.size(); mask++) {
+            int low = 0;
+            while (!(mask >> low & 1)) low++;
+            ternary[mask] = ternary[mask & (mask - 1)] + power3[low];
+        }
+        static const int dirs[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+        for (int r = 0; r < n; r++) {
+            for (int c = 0; c < n; c++) {
+                for (const auto& d : dirs) {
+                    int endR = r + d[0] * (k - 1), endC = c + d[1] * (k - 1);
+                    if (endR < 0 || endR >= n || endC < 0 || endC >= n) continue;
+                    uint16_t line = 0;
+                    for (int s = 0; s < k; s++) line |= (uint16_t)(1u << ((r + d[0] * s) * n + (c + d[1] * s)));
+                    lines.push_back(line);
+                }
+            }
+        }
+    }
+
+    uint32_t index(uint16_t x, uint16_t o) const { return ternary[x] + 2 * ternary[o]; }
+
+    bool hasLine(uint16_t stones) const {
+        for (uint16_t line : lines) {
+            if ((stones & line) == line) return true;
+        }
+        return false;
+    }
+};
+
+class SolvedTable {
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t boardSize;
+        uint32_t lineLength;
+        int32_t nextLayer;   // Stone count still to solve, -1 once complete
+        uint64_t positions;
+        uint64_t solved[3];  // Win / draw / loss counts over the finished layers
+        uint8_t reserved[8];
+    };
+    static_assert(sizeof(Header) == 64, "Header must stay 64 bytes");
+    static_assert(sizeof(std::atomic<uint8_t>) == 1, "Table bytes are updated in place as atomics");
+
+    Header* header;
+    uint8_t* cells;
+    size_t mappedBytes;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+
+    static size_t bytesFor(uint64_t positions) { return sizeof(Header) + (size_t)((positions + 3) / 4); }
+
+    bool adopt(void* view, size_t bytes, int n, int k, uint64_t positions) {
+        header = static_cast<Header*>(view);
+        cells = reinterpret_cast<uint8_t*>(header + 1);
+        mappedBytes = bytes;
+        if (memcmp(header->magic, "TTTSOLV", 8) != 0 || header->version != 1 || header->boardSize != (uint32_t)n ||
+            header->lineLength != (uint32_t)k || header->positions != positions || bytes < bytesFor(positions)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+public:
+    SolvedTable() : header(nullptr), cells(nullptr), mappedBytes(0)
+#ifdef _WIN32
+        , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+    {}
+
+    ~SolvedTable() { close(); }
+
+    // Read-only, for play. A missing, partial or mismatched table is not an
+    // error: the engine just searches.
+    bool open(const string& path, int n, int k) {
+        close();
+        if (n * n > 16) return false;
+        uint64_t positions = 1;
+        for (int i = 0; i < n * n; i++) positions *= 3;
+        void* view = nullptr;
+        size_t bytes = 0;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        bytes = (size_t)size.QuadPart;
+        if (bytes >= sizeof(Header)) mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Header)) {
+            bytes = (size_t)st.st_size;
+            view = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            if (view == MAP_FAILED) view = nullptr;
+        }
+        ::close(fd); // The mapping stays valid
+#endif
+        if (!view) {
+            close();
+            return false;
+        }
+        return adopt(view, bytes, n, k, positions);
+    }
+
+#ifndef _WIN32
+    // Read-write, for the solver: creates the file or picks up where it stopped.
+    // A file whose magic is still all zeros was cut off between creation and
+    // the header write and starts over; a started table shorter than the
+    // layout needs is refused rather than mapped past its end.
+    bool openForSolving(const string& path, int n, int k, uint64_t positions) {
+        close();
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return false;
+        struct stat st;
+        size_t bytes = bytesFor(positions);
+        char magic[8] = {0};
+        bool ok = fstat(fd, &st) == 0 && pread(fd, magic, sizeof(magic), 0) >= 0;
+        bool fresh = ok && all_of(magic, magic + sizeof(magic), [](char c) { return c == 0; });
+        if (fresh) ok = ftruncate(fd, 0) == 0 && ftruncate(fd, (off_t)bytes) == 0; // Zeroed cells: all unknown
+        else bytes = ok ? (size_t)st.st_size : 0;
+        void* view = nullptr;
+        if (ok && bytes >= bytesFor(positions)) {
+            view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (view == MAP_FAILED) view = nullptr;
+        }
+        ::close(fd);
+        if (!view) return false;
+        if (fresh) {
+            Header* h = static_cast<Header*>(view);
+            memcpy(h->magic, "TTTSOLV", 8);
+            h->version = 1;
+            h->boardSize = (uint32_t)n;
+            h->lineLength = (uint32_t)k;
+            h->nextLayer = n * n;
+            h->positions = positions;
+        }
+        return adopt(view, bytes, n, k, positions);
+    }
+
+    // Table bytes first, then the header that declares them finished
+    void commitLayer(int layer, const uint64_t counts[3]) {
+        msync(header, mappedBytes, MS_SYNC);
+        for (int v = 0; v < 3; v++) header->solved[v] += counts[v];
+        header->nextLayer = layer - 1;
+        msync(header, sizeof(Header), MS_SYNC);
+    }
+#endif
+
+    void close() {
+#ifdef _WIN32
+        if (header) UnmapViewOfFile(header);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (header) munmap(header, mappedBytes);
+#endif
+        header = nullptr;
+        cells = nullptr;
+        mappedBytes = 0;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    bool isComplete() const { return header && header->nextLayer < 0; }
+    int nextLayer() const { return header ? header->nextLayer : -1; }
+    const uint64_t* solvedCounts() const { return header->solved; }
+
+    // Four entries share a byte, so solver threads update it atomically
+    int value(uint32_t idx) const {
+        const std::atomic<uint8_t>* byte = reinterpret_cast<const std::atomic<uint8_t>*>(cells + idx / 4);
+        return byte->load(std::memory_order_relaxed) >> (idx % 4 * 2) & 3;
+    }
+
+    // Entries start as SOLVED_UNKNOWN (0) and are written once, so OR-ing is
+    // enough, and redoing an interrupted layer writes the same bits again
+    void store(uint32_t idx, int v) {
+        std::atomic<uint8_t>* byte = reinterpret_cast<std::atomic<uint8_t>*>(cells + idx / 4);
+        byte->fetch_or((uint8_t)(v << (idx % 4 * 2)), std::memory_order_relaxed);
+    }
+};
+
+// Perfect move from a complete solved table: an immediate win, else a move
+// that keeps a win, else one that keeps the draw. Returns -1 when the table
+// is not available or every move loses (the engine then makes the win as
+// hard as it can).
+template <int N, int K>
+int probeSolvedTable(const SolvedTable& table, const SolverGeometry& geometry, const GridBoard<N, K>& position, char mover,
+                     int* value = nullptr) {
+    if (!table.isComplete()) return -1;
+    uint16_t x = (uint16_t)position.x.to_ulong(), o = (uint16_t)position.o.to_ulong();
+    uint32_t idx = geometry.index(x, o), step = (mover == 'X' ? 1 : 2);
+    int drawMove = -1, winMove = -1;
+    for (int i = 0; i < N * N; i++) {
+        if (!position.isEmpty(i)) continue;
+        uint16_t after = (uint16_t)((mover == 'X' ? x : o) | 1u << i);
+        if (geometry.hasLine(after)) {
+            if (value) *value = SOLVED_WIN;
+            return i;
+        }
+        int child = table.value(idx + step * geometry.power3[i]);
+        if (child == SOLVED_LOSS && winMove < 0) winMove = i;
+        else if (child == SOLVED_DRAW && drawMove < 0) drawMove = i;
+    }
+    int move = winMove >= 0 ? winMove : drawMove;
+    if (value && move >= 0) *value = winMove >= 0 ? SOLVED_WIN : SOLVED_DRAW;
+    return move;
+}
+
+// Player statistics structure
+struct PlayerStats {
+    string name;
+    bool computer; // Computer opponents are rated apart from people with the same name
+    int wins;
+    int losses;
+    int ties;
+    int totalGames;
+    double winRate;
+    double rating; // Elo
+    
+    PlayerStats() : computer(false), wins(0), losses(0), ties(0), totalGames(0), winRate(0.0), rating(1200.0) {}
+    
+    void updateStats(int result) { // 1=win, 0=tie, -1=loss
+        totalGames++;
+        if (result == 1) wins++;
+        else if (result == 0) ties++;
+        else losses++;
+        winRate = (totalGames > 0) ? (double)wins / totalGames * 100 : 0.0;
+    }
+};
+
+// Longest name a GameRecord keeps whole; longer ones are refused at the prompt
+// so two people never end up sharing a truncated name
+const size_t MAX_PLAYER_NAME = sizeof(GameRecord::playerX) - 1;
+
+// Games between registry snapshots; a clean exit always writes one
+const uint64_t PLAYER_SNAPSHOT_INTERVAL = 1000;
+
+// Whether a side of a record was played by the computer
+bool isComputerSide(const GameRecord& record, char side) {
+    return side == 'O' && record.mode != MODE_MULTIPLAYER;
+}
+
+// Name under which a side of a record is rated. Computer opponents are rated
+// per difficulty/board so their Elo means something.
+string ratedPlayerName(const GameRecord& record, char side) {
+    if (side == 'X') return string(record.playerX, strnlen(record.playerX, sizeof(record.playerX)));
+    string difficultyName[] = {"", "Easy", "Medium", "Hard", "Impossible"};
+    if (record.mode == MODE_VS_COMPUTER) return "Computer (" + difficultyName[record.level % 5] + ")";
+    if (record.mode == MODE_BIG_BOARD) return "Computer (" + to_string(record.level) + "x" + to_string(record.level) + ")";
+    if (record.mode == MODE_ULTIMATE) return "Computer (Ultimate)";
+    return string(record.playerO, strnlen(record.playerO, sizeof(record.playerO)));
+}
+
+// All players by name, plus a rating-ordered index that is kept up to date on
+// every game (O(log n)), so the top of the leaderboard is read off directly
+// instead of sorting every player each time it is shown. The registry is saved
+// as a snapshot covering the first `logCount` records of the game log, so a
+// restart only replays the games played since.
+class PlayerRegistry {
+private:
+    struct ByRating {
+        bool operator()(const PlayerStats* a, const PlayerStats* b) const {
+            if (a->rating != b->rating) return a->rating > b->rating;
+            if (a->name != b->name) return a->name < b->name;
+            return a->computer < b->computer;
+        }
+    };
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved0;
+        uint64_t playerCount;
+        uint64_t logCount;    // Log records folded into the snapshot
+        uint64_t fingerprint; // Of the last of them, so a replaced log is noticed
+        uint8_t reserved[24];
+    };
+    static_assert(sizeof(SnapshotHeader) == 64, "Header must stay 64 bytes");
+
+    std::unordered_map<string, PlayerStats> players; // Nodes never move, so the index can point into it
+    std::set<const PlayerStats*, ByRating> ranking;
+
+    static constexpr double ELO_K = 32.0;
+
+    // People and computer opponents never share a key
+    static string key(const string& name, bool computer) { return (computer ? "C:" : "H:") + name; }
+
+    PlayerStats& get(const string& name, bool computer) {
+        string k = key(name, computer);
+        auto it = players.find(k);
+        if (it == players.end()) {
+            it = players.emplace(k, PlayerStats()).first;
+            it->second.name = name;
+            it->second.computer = computer;
+            ranking.insert(&it->second);
+        }
+        return it->second;
+    }
+
+public:
+    size_t size() const { return players.size(); }
+
+    void clear() {
+        ranking.clear();
+        players.clear();
+    }
+
+    const PlayerStats* find(const string& name, bool computer) const {
+        auto it = players.find(key(name, computer));
+        return it == players.end() ? nullptr : &it->second;
+    }
+
+    // result is from X's point of view: 1 = X won, 0 = tie, -1 = O won
+    void recordGame(const string& playerX, bool xComputer, const string& playerO, bool oComputer, int result) {
+        PlayerStats& x = get(playerX, xComputer);
+        PlayerStats& o = get(playerO, oComputer);
+        ranking.erase(&x); // Must leave the index before its key changes
+        ranking.erase(&o);
+        double expected = 1.0 / (1.0 + pow(10.0, (o.rating - x.rating) / 400.0));
+        double delta = ELO_K * ((result + 1) / 2.0 - expected);
+        x.rating += delta;
+        o.rating -= delta;
+        x.updateStats(result);
+        o.updateStats(-result);
+        ranking.insert(&x);
+        ranking.insert(&o);
+    }
+
+    void recordGame(const GameRecord& record) {
+        int result = (record.result == RESULT_X_WINS) ? 1 : (record.result == RESULT_O_WINS ? -1 : 0);
+        recordGame(ratedPlayerName(record, 'X'), isComputerSide(record, 'X'),
+                   ratedPlayerName(record, 'O'), isComputerSide(record, 'O'), result);
+    }
+
+    vector<const PlayerStats*> top(size_t k) const {
+        vector<const PlayerStats*> leaders;
+        for (auto it = ranking.begin(); it != ranking.end() && leaders.size() < k; ++it) leaders.push_back(*it);
+        return leaders;
+    }
+
+    // Written to a temporary file and renamed over the old snapshot, so a
+    // crash leaves either the old snapshot or the new one
+    bool save(const string& path, uint64_t logCount, uint64_t fingerprint) const {
+        string temp = path + ".tmp";
+        FILE* out = fopen(temp.c_str(), "wb");
+        if (!out) return false;
+        SnapshotHeader header = {};
+        memcpy(header.magic, "TTTPLYR", 8);
+        header.version = 1;
+        header.playerCount = players.size();
+        header.logCount = logCount;
+        header.fingerprint = fingerprint;
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+        for (const auto& entry : players) {
+            const PlayerStats& p = entry.second;
+            uint8_t flags = p.computer ? 1 : 0, length = (uint8_t)min(p.name.size(), (size_t)255);
+            int32_t counts[3] = {p.wins, p.losses, p.ties};
+            ok = ok && fwrite(&flags, 1, 1, out) == 1 && fwrite(&length, 1, 1, out) == 1 &&
+                 fwrite(p.name.data(), 1, length, out) == length && fwrite(counts, sizeof(counts), 1, out) == 1 &&
+                 fwrite(&p.rating, sizeof(p.rating), 1, out) == 1;
+        }
+        ok = (fclose(out) == 0) && ok;
+        if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+            remove(temp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Replaces the registry with a snapshot; false (registry left empty) if
+    // the file is missing or damaged
+    bool load(const string& path, uint64_t& logCount, uint64_t& fingerprint) {
+        clear();
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in) return false;
+        SnapshotHeader header;
+        bool ok = fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, "TTTPLYR", 8) == 0 && header.version == 1;
+        // Every entry takes at least flags, length, counts and rating, so the
+        // file size bounds the count before anything is reserved for it
+        const long minEntryBytes = 2 + sizeof(int32_t[3]) + sizeof(double);
+        long fileBytes = (ok && fseek(in, 0, SEEK_END) == 0) ? ftell(in) : -1;
+        ok = ok && fileBytes >= (long)sizeof(header) && fseek(in, sizeof(header), SEEK_SET) == 0 &&
+             header.playerCount <= (uint64_t)((fileBytes - (long)sizeof(header)) / minEntryBytes);
+        players.reserve(ok ? (size_t)header.playerCount : 0);
+        for (uint64_t i = 0; ok && i < header.playerCount; i++) {
+            uint8_t flags, length;
+            char name[256];
+            int32_t counts[3];
+            double rating;
+            ok = fread(&flags, 1, 1, in) == 1 && fread(&length, 1, 1, in) == 1 && fread(name, 1, length, in) == length &&
+                 fread(counts, sizeof(counts), 1, in) == 1 && fread(&rating, sizeof(rating), 1, in) == 1 &&
+                 std::isfinite(rating); // NaN would break the ranking's ordering
+            if (!ok) break;
+            auto inserted = players.emplace(key(string(name, length), flags & 1), PlayerStats());
+            if (!inserted.second) { // A duplicate would be re-ranked while still in the index
+                ok = false;
+                break;
+            }
+            PlayerStats& p = inserted.first->second;
+            p.name.assign(name, length);
+            p.computer = flags & 1;
+            p.wins = counts[0];
+            p.losses = counts[1];
+            p.ties = counts[2];
+            p.totalGames = p.wins + p.losses + p.ties;
+            p.winRate = p.totalGames > 0 ? (double)p.wins / p.totalGames * 100 : 0.0;
+            p.rating = rating;
+            ranking.insert(&p);
+        }
+        fclose(in);
+        if (!ok) {
+            clear();
+            return false;
+        }
+        logCount = header.logCount;
+        fingerprint = header.fingerprint;
+        return true;
+    }
+};
+
+// Thinks on the human's time: a background thread works out the computer's
+// reply to each candidate human move, most likely first, until the human
+// moves and finish() is called. A reply the thread got to is then free.
+template <typename Reply>
+class Ponderer {
+private:
+    std::thread worker;
+    std::atomic<bool> stopFlag;
+    std::atomic<int> done;
+    vector<int> candidates;
+    vector<Reply> replies;  // Same order as candidates
+    vector<char> ready;     // Written by the worker, read only after finish()
+
+public:
+    Ponderer() : stopFlag(false), done(0) {}
+    ~Ponderer() { finish(); }
+
+    // think(humanMove, stopFlag, reply) returns false if it was stopped early
+    template <typename Think>
+    void start(const vector<int>& moves, Think think) {
+        finish();
+        candidates = moves;
+        replies.assign(moves.size(), Reply());
+        ready.assign(moves.size(), 0);
+        stopFlag = false;
+        done = 0;
+        worker = std::thread([this, think]() {
+            for (size_t i = 0; i < candidates.size() && !stopFlag.load(std::memory_order_relaxed); i++) {
+                if (think(candidates[i], stopFlag, replies[i])) {
+                    ready[i] = 1;
+                    done.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    void finish() {
+        stopFlag = true;
+        if (worker.joinable()) worker.join();
+    }
+
+    // Progress for the status line, safe while the worker runs
+    int readyCount() const { return done.load(std::memory_order_relaxed); }
+    int candidateCount() const { return (int)candidates.size(); }
+
+    // Only after finish(): the pondered reply to `humanMove`, or nullptr
+    const Reply* replyTo(int humanMove) const {
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (candidates[i] == humanMove && ready[i]) return &replies[i];
+        }
+        return nullptr;
+    }
+};
+
+// Game class untuk mengelola semua aspek permainan
+class TicTacToeGame {
+private:
+    BitBoard board;
+    FrameRenderer frame;
+    SymmetricHash<3> searchHash;
+    TranspositionTable transpositions;
+    long long searchNodes;
+    int killerMoves[10][2];  // Per ply: last two moves that caused a cutoff
+    int historyScore[2][9];  // Per side: how often a cell caused a cutoff
+    PlayerRegistry players; // Use ratedPlayers(): loaded on first use
+    bool playersLoaded;
+    uint64_t playersSavedAt; // Log size when the registry snapshot was last written
+    GameLog gameLog;
+    RingBuffer<GameRecord> recentGames; // This session's games, used when the log is unavailable
+    int currentMoves[9]; // Cells played so far in the current 3x3 game
+    int currentMoveCount;
+    int redoMoves[9];    // Moves taken back with undo, most recent last
+    int redoCount;
+    bool soundEnabled;
+    int totalGamesPlayed;
+    GameRng seedSource; // Draws a fresh seed for every game
+    GameRng gameRng;    // Stream for the current game's AI choices
+    GameRng rngAtPly[10]; // gameRng after each ply, so undo/redo rewinds it with the board
+    uint64_t gameSeed;
+    struct PonderedReply {
+        int move;
+        GameRng rngAfter;
+    };
+    Ponderer<PonderedReply> ponder; // Computer replies worked out during the player's turn
+    const LearnedPolicy& policy;    // Medium/Hard, if --train has written and enabled one
+    
+public:
+    explicit TicTacToeGame(size_t historyCapacity = 10)
+        : searchHash(ZOBRIST_3X3), searchNodes(0), playersLoaded(false), playersSavedAt(0), recentGames(historyCapacity), currentMoveCount(0), redoCount(0),
+          soundEnabled(true), totalGamesPlayed(0), gameSeed(0), policy(installedPolicy()) {
+        clearBoard();
+        gameLog.open(GAME_LOG_FILE);
+        resetSearchHeuristics();
+        enableAnsiColors(); // Enable ANSI colors at startup
+    }
+    
+    // The registry as of the whole game log. Loaded on first use rather than at
+    // startup: the snapshot, then only the games logged after it.
+    PlayerRegistry& ratedPlayers() {
+        if (playersLoaded) return players;
+        playersLoaded = true;
+        if (!gameLog.isOpen()) return players; // Only this session's games
+        uint64_t covered = 0, fingerprint = 0;
+        if (!players.load(PLAYERS_FILE, covered, fingerprint) || covered > gameLog.size() ||
+            (covered > 0 && recordFingerprint(gameLog.at(covered - 1)) != fingerprint)) {
+            players.clear(); // No snapshot, or one of another log: start over
+            covered = 0;
+        }
+        for (uint64_t i = covered; i < gameLog.size(); i++) players.recordGame(gameLog.at(i));
+        playersSavedAt = covered;
+        if (gameLog.size() - covered >= PLAYER_SNAPSHOT_INTERVAL) savePlayers();
+        return players;
+    }
+    
+    void savePlayers() {
+        if (!playersLoaded || !gameLog.isOpen() || gameLog.size() == playersSavedAt) return;
+        uint64_t count = gameLog.size();
+        if (players.save(PLAYERS_FILE, count, count > 0 ? recordFingerprint(gameLog.at(count - 1)) : 0)) playersSavedAt = count;
+    }
+    
+    // Names longer than a record holds are refused rather than truncated
+    string readPlayerName(const string& prompt) {
+        while (true) {
+            cout << BOLD << prompt << RESET;
+            string name = terminal.readLine();
+            if (name.size() <= MAX_PLAYER_NAME) return name;
+            cout << RED << "Names can be at most " << MAX_PLAYER_NAME << " characters.\n" << RESET;
+        }
+    }
+    
+    void clearBoard() {
+        board.clear();
+        currentMoveCount = 0;
+        redoCount = 0;
+    }
+    
+    // Move list for the interactive game. A new move drops the redo list.
+    // The AI stream is rewound with the board so the game's seed still
+    // replays the moves that were finally played.
+    void makeGameMove(int cell) {
+        board.makeMove(cell);
+        currentMoves[currentMoveCount++] = cell;
+        rngAtPly[currentMoveCount] = gameRng;
+        redoCount = 0;
+    }
+    
+    bool undoGameMove() {
+        if (currentMoveCount == 0) return false;
+        int cell = currentMoves[--currentMoveCount];
+        board.unmakeMove(cell);
+        redoMoves[redoCount++] = cell;
+        gameRng = rngAtPly[currentMoveCount];
+        return true;
+    }
+    
+    bool redoGameMove() {
+        if (redoCount == 0) return false;
+        int cell = redoMoves[--redoCount];
+        board.makeMove(cell);
+        currentMoves[currentMoveCount++] = cell;
+        gameRng = rngAtPly[currentMoveCount]; // Redone plies were not overwritten: a new move clears the redo list
+        return true;
+    }
+    
+    void clearScreen() {
+        frame.invalidate(); // Whatever the frame renderer drew is gone
+        #ifdef _WIN32
+            system("cls");
+        #else
+            // Clear screen and move cursor to top-left
+            cout << "\033[2J\033[H";
+        #endif
+    }
+    
+    void playSound(string sound) {
+        if (!soundEnabled) return;
+        #ifdef _WIN32
+            if (sound == "move") Beep(800, 100);
+            else if (sound == "win") Beep(1000, 200);
+            else if (sound == "lose") Beep(400, 300);
+            else if (sound == "tie") Beep(600, 150);
+            else if (sound == "select") Beep(700, 50); // New sound for menu selection
+        #endif
+    }
+
+    // Typing effect for messages
+    void typeMessage(const string& message, int delay_ms = 30) {
+        if (skipCosmeticDelays) {
+            cout << message << RESET;
+            return;
+        }
+        for (char c : message) {
+            cout << c << flush;
+            customSleep(delay_ms);
+        }
+        cout << RESET; // Ensure color reset after messageeeeeeeeeeeee
+    }
+    
+    void printHeader() {
+        clearScreen();
+        writeHeader(cout);
+    }
+    
+    void writeHeader(ostream& out) {
+        out << BOLD << BG_BLUE << WHITE << "============================================================\n";
+        out << "             BERN'S TIC TAC TOE PROJECT                  \n";
+        out << "              " << YELLOW << "Created by: Group Bern" << WHITE << "                 \n";
+        out << "============================================================" << RESET << "\n\n";
+    }
+    
+    const char* cellColor(char cell) {
+        return cell == 'X' ? RED : (cell == 'O' ? GREEN : WHITE);
+    }
+    
+    void drawAdvancedBoard(ostream& out = cout) {
+        out << BOLD << CYAN << "\n     * GAME BOARD *\n\n" << RESET;
+        for (int row = 0; row < 3; row++) {
+            char a = board.at(row * 3), b = board.at(row * 3 + 1), c = board.at(row * 3 + 2);
+            out << BLUE << "     |     |     \n";
+            out << "  " << cellColor(a) << a << BLUE << "  |  "
+                 << cellColor(b) << b << BLUE << "  |  "
+                 << cellColor(c) << c << BLUE << "  \n";
+            if (row < 2) out << "_____|_____|_____\n";
+        }
+        out << "     |     |     \n" << RESET;
+        out << '\n';
+    }
+    
+    void showMenu() {
+        printHeader();
+        cout << BOLD << YELLOW << "*** SELECT GAME MODE ***\n\n" << RESET;
+        cout << "1. " << GREEN << "VS Computer (AI Challenge)\n" << RESET;
+        cout << "2. " << CYAN << "Multiplayer (Local Battle)\n" << RESET;
+        cout << "3. " << MAGENTA << "View Statistics\n" << RESET;
+        cout << "4. " << WHITE << "Toggle Sound (" << (soundEnabled ? GREEN "ON" : RED "OFF") << WHITE << ")\n" << RESET;
+        cout << "5. " << BLUE << "Game History\n" << RESET;
+        cout << "6. " << YELLOW << "Big Board Challenge (4x4 / 5x5 / 15x15)\n" << RESET;
+        cout << "7. " << MAGENTA << "Ultimate Tic-Tac-Toe (MCTS AI)\n" << RESET;
+        cout << "8. " << CYAN << "Engine Stats (AI & render timings)\n" << RESET;
+        cout << "9. " << RED << "Exit Game\n\n" << RESET;
+        cout << BOLD << "Enter your choice (1-9): " << RESET;
+    }
+    
+    int getDifficultyLevel() {
+        int difficulty;
+        printHeader(); // Clear and print header again for clean look
+        cout << BOLD << YELLOW << "*** SELECT AI DIFFICULTY ***\n\n" << RESET;
+        cout << "1. " << GREEN << "Easy Mode (Random moves)\n" << RESET;
+        cout << "2. " << CYAN << (policy.plays(2) ? "Medium Mode (Learned policy, relaxed)\n" : "Medium Mode (Smart offense)\n") << RESET;
+        cout << "3. " << MAGENTA << (policy.plays(3) ? "Hard Mode (Learned policy, sharp)\n" : "Hard Mode (Master AI)\n") << RESET;
+        cout << "4. " << RED << "Impossible Mode (Unbeatable)\n\n" << RESET;
+        
+        do {
+            cout << BOLD << "Choose difficulty (1-4): " << RESET;
+            difficulty = terminal.readNumber();
+            playSound("select");
+            if (difficulty < 1 || difficulty > 4) {
+                cout << RED << "Invalid choice! Please select 1-4.\n" << RESET;
+                customSleep(500);
+            }
+        } while (difficulty < 1 || difficulty > 4);
+        
+        return difficulty;
+    }
+    
+    // Status line above the prompt (e.g. pondering progress), redrawn in place
+    // while the player is typing
+    std::function<void()> statusRefresher(const std::function<string()>& status) {
+        if (!status) return nullptr;
+        return [status]() { cout << "\0337\033[1A\r\033[K" << CYAN << status() << RESET << "\0338" << flush; };
+    }
+    
+    // Reads a move, or 'u'/'r' to undo/redo `plies` moves (2 against the computer
+    // so it's the player's turn again). Returns false if the board was rewound.
+    bool playerMove(char player, string playerName, int plies, const std::function<string()>& status = nullptr) {
+        while (true) {
+            if (status) cout << CYAN << status() << RESET << "\n";
+            cout << BOLD << "Player " << (player == 'X' ? RED : GREEN) << playerName << RESET << " (" << (player == 'X' ? RED : GREEN) << player << RESET << "), choose position (1-9, u=undo, r=redo): " << RESET;
+            string input = terminal.readLine(statusRefresher(status));
+            
+            if (input == "u" || input == "U" || input == "r" || input == "R") {
+                bool undo = (input == "u" || input == "U");
+                if ((undo ? currentMoveCount : redoCount) < plies) {
+                    cout << RED << (undo ? "Nothing to undo!\n" : "Nothing to redo!\n") << RESET;
+                    customSleep(500);
+                    continue;
+                }
+                for (int i = 0; i < plies; i++) {
+                    if (undo) undoGameMove();
+                    else redoGameMove();
+                }
+                playSound("select");
+                return false;
+            }
+            
+            int choice = atoi(input.c_str());
+            if (choice < 1 || choice > 9) {
+                cout << RED << "Invalid position! Choose 1-9.\n" << RESET;
+                customSleep(500);
+                continue;
+            }
+            
+            choice--; // Adjust to 0-indexed array
+            if (board.isEmpty(choice)) {
+                makeGameMove(choice);
+                playSound("move");
+                break;
+            }
+            cout << RED << "Position occupied! Try another spot.\n" << RESET;
+            customSleep(500);
+        }
+        return true;
+    }
+    
+    // Starts working out the computer's reply to every move the player can make
+    void startPondering(char computer, char player, int difficulty) {
+        vector<int> moves;
+        for (int i : MOVE_ORDER) {
+            if (board.isEmpty(i)) moves.push_back(i);
+        }
+        BitBoard position = board;
+        GameRng rng = gameRng;
+        const LearnedPolicy* learned = &policy;
+        ponder.start(moves, [=](int human, const std::atomic<bool>&, PonderedReply& reply) {
+            BitBoard next = position;
+            next.place(human, player);
+            if (next.isTerminal()) return false;
+            reply.rngAfter = rng; // Same stream the live move would use, so seeds still replay
+            reply.move = chooseAiMove(next, computer, player, difficulty, reply.rngAfter, learned);
+            return true;
+        });
+    }
+    
+    void computerMove(char computer, char player, int difficulty) {
+        int choice = -1;
+        
+        cout << BOLD << YELLOW << "Computer is thinking..." << RESET << "\n";
+        
+        {
+            MetricTimer thinking(HIST_AI_MOVE_US);
+            const PonderedReply* pondered = currentMoveCount > 0 ? ponder.replyTo(currentMoves[currentMoveCount - 1]) : nullptr;
+            if (pondered) {
+                choice = pondered->move;
+                gameRng = pondered->rngAfter;
+            } else {
+                choice = chooseAiMove(board, computer, player, difficulty, gameRng, &policy);
+            }
+            Metrics::add(COUNTER_AI_MOVES);
+            Metrics::add(pondered ? COUNTER_PONDER_HITS : COUNTER_PONDER_MISSES);
+        }
+        
+        makeGameMove(choice);
+        cout << BOLD << CYAN << "Computer chose position " << (choice + 1) << "!\n" << RESET;
+        playSound("move");
+    }
+    
+    // Micro-benchmarks for the engine hot paths over fixed, seeded corpora.
+    // Reports ns/op, search nodes/sec and heap allocations/op (COUNT_ALLOCATIONS
+    // builds only; otherwise "n/a" / null), as a table or JSON.
+    void runBenchmarks(bool json) {
+        struct Result {
+            string name;
+            string corpus;
+            long long ops;
+            double nsPerOp;
+            double nodesPerSec;
+            double allocsPerOp;
+        };
+        vector<Result> results;
+        volatile long long sink = 0;
+        const vector<BenchCorpus> corpora = buildBenchCorpora(0xBE7C4, 1024);
+        
+        // Repeats passes over the corpus until at least minSeconds have elapsed.
+        // `op` returns the search nodes it visited (0 for non-search benchmarks).
+        auto measure = [&](const string& name, const BenchCorpus& corpus, auto op) {
+            const double minSeconds = 0.2;
+            long long ops = 0, nodes = 0;
+            long long allocsBefore = heapAllocationCount();
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0.0;
+            do {
+                for (const BitBoard& position : corpus.positions) {
+                    nodes += op(position);
+                    ops++;
+                }
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } while (elapsed < minSeconds);
+            double allocsPerOp = allocsBefore < 0 ? -1.0 : (double)(heapAllocationCount() - allocsBefore) / ops;
+            results.push_back(Result{name, corpus.name, ops, elapsed * 1e9 / ops, nodes / elapsed, allocsPerOp});
+        };
+        
+        for (const BenchCorpus& corpus : corpora) {
+            measure("checkWinner", corpus, [&](const BitBoard& p) {
+                board = p;
+                sink = sink + checkWinner();
+                return 0LL;
+            });
+            measure("isTie", corpus, [&](const BitBoard& p) {
+                board = p;
+                sink = sink + isTie();
+                return 0LL;
+            });
+            measure("findWinningMove", corpus, [&](const BitBoard& p) {
+                sink = sink + findWinningMove(p, 'X') + findWinningMove(p, 'O');
+                return 0LL;
+            });
+            measure("minimaxMove", corpus, [&](const BitBoard& p) {
+                board = p;
+                transpositions.clear(); // Cold table: measures a full search
+                resetSearchHeuristics();
+                long long before = searchNodes;
+                char toMove = p.sideToMove();
+                sink = sink + minimaxMove(toMove, toMove == 'X' ? 'O' : 'X');
+                return searchNodes - before;
+            });
+            for (int level = 1; level <= 4; level++) {
+                GameRng rng(level);
+                measure("computerMove/L" + to_string(level), corpus, [&](const BitBoard& p) {
+                    char toMove = p.sideToMove();
+                    sink = sink + chooseAiMove(p, toMove, toMove == 'X' ? 'O' : 'X', level, rng, &policy);
+                    return 0LL;
+                });
+            }
+        }
+        clearBoard();
+        
+        // Batch classification: every position of random games, terminal ones
+        // included, as structure-of-arrays. Each kernel is first checked against
+        // a plain line-mask loop on all 3^9 boards.
+        vector<uint16_t> xs, os;
+        vector<BitBoard> mixed; // The same positions for the one-at-a-time path
+        GameRng gameRng(0xC1A55);
+        while (xs.size() < 65536) {
+            BitBoard p;
+            do {
+                p.makeMove(randomEmptyCell(p, gameRng));
+                xs.push_back(p.x);
+                os.push_back(p.o);
+                mixed.push_back(p);
+            } while (!p.isTerminal());
+        }
+        vector<uint16_t> allX, allO;
+        for (int idx = 0; idx < POSITION_COUNT; idx++) {
+            uint16_t x = 0, o = 0;
+            for (int i = 0, rest = idx; i < 9; i++, rest /= 3) {
+                if (rest % 3 == 1) x |= (uint16_t)(1u << i);
+                else if (rest % 3 == 2) o |= (uint16_t)(1u << i);
+            }
+            allX.push_back(x);
+            allO.push_back(o);
+        }
+        vector<uint8_t> expected(POSITION_COUNT), classes(max(xs.size(), allX.size()));
+        for (size_t i = 0; i < allX.size(); i++) { // Reference: the plain line-mask loop
+            expected[i] = hasLineMask(allX[i]) ? OUTCOME_X_WINS : hasLineMask(allO[i]) ? OUTCOME_O_WINS
+                        : (allX[i] | allO[i]) == FULL_BOARD ? OUTCOME_DRAW : OUTCOME_ONGOING;
+        }
+        
+        auto measureBatch = [&](const string& name, auto op) {
+            const double minSeconds = 0.2;
+            long long ops = 0;
+            long long allocsBefore = heapAllocationCount();
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0.0;
+            do {
+                op();
+                ops += (long long)xs.size();
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } while (elapsed < minSeconds);
+            double allocsPerOp = allocsBefore < 0 ? -1.0 : (double)(heapAllocationCount() - allocsBefore) / ops;
+            results.push_back(Result{name, "mixed", ops, elapsed * 1e9 / ops, 0.0, allocsPerOp});
+        };
+        measureBatch("checkWinner+isTie", [&]() {
+            for (size_t i = 0; i < xs.size(); i++) {
+                board = mixed[i];
+                char winner = checkWinner();
+                classes[i] = winner == 'X' ? OUTCOME_X_WINS : winner == 'O' ? OUTCOME_O_WINS : isTie() ? OUTCOME_DRAW : OUTCOME_ONGOING;
+            }
+            sink = sink + classes[xs.size() - 1];
+        });
+        for (const ClassifierChoice& kernel : availableClassifiers()) {
+            kernel.kernel(allX.data(), allO.data(), classes.data(), allX.size());
+            if (!std::equal(expected.begin(), expected.end(), classes.begin())) {
+                cout << RED << "classify/" << kernel.name << " disagrees with the line-mask reference!\n" << RESET;
+            }
+            measureBatch(string("classify/") + kernel.name, [&]() {
+                kernel.kernel(xs.data(), os.data(), classes.data(), xs.size());
+                sink = sink + classes[xs.size() - 1];
+            });
+        }
+        clearBoard();
+        
+        if (json) {
+            cout << "{\n  \"benchmarks\": [\n";
+            for (size_t i = 0; i < results.size(); i++) {
+                const Result& r = results[i];
+                cout << "    {\"name\": \"" << r.name << "\", \"corpus\": \"" << r.corpus << "\", \"ops\": " << r.ops
+                     << fixed << setprecision(2) << ", \"ns_per_op\": " << r.nsPerOp
+                     << ", \"nodes_per_sec\": " << setprecision(0) << r.nodesPerSec
+                     << ", \"allocs_per_op\": ";
+                if (r.allocsPerOp < 0) cout << "null";
+                else cout << setprecision(4) << r.allocsPerOp;
+                cout << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+            }
+            cout << "  ]\n}\n";
+            return;
+        }
+        cout << left << setw(18) << "benchmark" << setw(15) << "corpus" << right << setw(12) << "ns/op"
+             << setw(16) << "nodes/sec" << setw(12) << "allocs/op" << "\n";
+        for (const Result& r : results) {
+            cout << left << setw(18) << r.name << setw(15) << r.corpus << right << fixed
+                 << setw(12) << setprecision(2) << r.nsPerOp
+                 << setw(16) << setprecision(0) << r.nodesPerSec
+                 << setw(12);
+            if (r.allocsPerOp < 0) cout << "n/a";
+            else cout << setprecision(4) << r.allocsPerOp;
+            cout << "\n";
+        }
+    }
+    
+    // Make/undo a move during search, keeping the symmetry hash in step
+    void makeSearchMove(int i, char player) {
+        board.place(i, player);
+        searchHash.toggle(i, player);
+    }
+    
+    void undoSearchMove(int i, char player) {
+        board.remove(i);
+        searchHash.toggle(i, player);
+    }
+    
+    void resetSearchHeuristics() {
+        for (auto& ply : killerMoves) ply[0] = ply[1] = -1;
+        for (auto& side : historyScore) for (int& h : side) h = 0;
+    }
+    
+    // Root keeps the fixed MOVE_ORDER so ties break the same way as PERFECT_PLAY;
+    // deeper plies try killer moves first, then history, then MOVE_ORDER.
+    int orderMoves(int ply, char mover, int moves[9]) {
+        int count = 0;
+        int keys[9];
+        int side = (mover == 'X' ? 0 : 1);
+        for (int rank = 0; rank < 9; rank++) {
+            int i = MOVE_ORDER[rank];
+            if (!board.isEmpty(i)) continue;
+            int key = 9 - rank;
+            if (ply > 0) {
+                if (i == killerMoves[ply][0]) key += 2000;
+                else if (i == killerMoves[ply][1]) key += 1000;
+                key += historyScore[side][i] * 16;
+            }
+            // Insertion sort, stable for equal keys
+            int pos = count++;
+            while (pos > 0 && keys[pos - 1] < key) {
+                keys[pos] = keys[pos - 1];
+                moves[pos] = moves[pos - 1];
+                pos--;
+            }
+            keys[pos] = key;
+            moves[pos] = i;
+        }
+        return count;
+    }
+    
+    int minimaxMove(char computer, char player) {
+        int bestMove = -1;
+        int bestScore = -WIN_SCORE - 1;
+        
+        searchHash.reset();
+        for (int i = 0; i < 9; i++) {
+            if (!board.isEmpty(i)) searchHash.toggle(i, board.at(i));
+        }
+        
+        int moves[9];
+        int count = orderMoves(0, computer, moves);
+        for (int m = 0; m < count; m++) {
+            int i = moves[m];
+            makeSearchMove(i, computer);
+            int score = -negamax(1, -WIN_SCORE - 1, -bestScore, player, computer); // Opponent's turn
+            undoSearchMove(i, computer);
+            
+            if (score > bestScore) {
+                bestScore = score;
+                bestMove = i;
+            }
+        }
+        return bestMove;
+    }
+    
+    // Debug path: checks the compile-time table against the live minimax search
+    // for every reachable position. Returns the number of mismatches.
+    int verifyPerfectPlayTable() {
+        int checked = 0, mismatches = 0;
+        vector<bool> seen(POSITION_COUNT, false);
+        clearBoard();
+        verifyPerfectPlayFrom('X', seen, checked, mismatches);
+        cout << "Checked " << checked << " positions, " << mismatches << " mismatches\n";
+        cout << "Search nodes: " << searchNodes << " | TT hits: " << transpositions.hits
+             << " | misses: " << transpositions.misses << " | stores: " << transpositions.stores
+             << " | hit rate: " << fixed << setprecision(1) << transpositions.hitRate() << "%\n";
+        return mismatches;
+    }
+    
+    void verifyPerfectPlayFrom(char toMove, vector<bool>& seen, int& checked, int& mismatches) {
+        int idx = positionIndex(board.x, board.o);
+        if (seen[idx] || checkWinner() != ' ' || isTie()) return;
+        seen[idx] = true;
+        char other = (toMove == 'X' ? 'O' : 'X');
+        int expected = minimaxMove(toMove, other);
+        checked++;
+        if (PERFECT_PLAY.bestMove(idx) != expected) {
+            mismatches++;
+            cout << RED << "Mismatch at position " << idx << ": table " << PERFECT_PLAY.bestMove(idx)
+                 << ", minimax " << expected << "\n" << RESET;
+        }
+        for (int i = 0; i < 9; i++) {
+            if (board.isEmpty(i)) {
+                board.place(i, toMove);
+                verifyPerfectPlayFrom(other, seen, checked, mismatches);
+                board.remove(i);
+            }
+        }
+    }
+    
+    // Negamax with alpha-beta. Scores are from the mover's point of view and
+    // depth-aware; the TT stores them relative to the node so they stay valid
+    // when the same position is reached from a different root.
+    int negamax(int ply, int alpha, int beta, char mover, char other) {
+        searchNodes++;
+        if (checkWinner() != ' ') return -(WIN_SCORE - ply); // Previous mover won
+        if (isTie()) return 0;
+        
+        uint64_t key = searchHash.canonical(mover);
+        int alphaOrig = alpha;
+        int cached, cachedDepth;
+        uint8_t bound;
+        if (transpositions.probe(key, cached, bound, cachedDepth)) {
+            int score = cached > 0 ? cached - ply : (cached < 0 ? cached + ply : 0);
+            if (bound == BOUND_EXACT) return score;
+            if (bound == BOUND_LOWER) alpha = max(alpha, score);
+            else beta = min(beta, score);
+            if (alpha >= beta) return score;
+        }
+        
+        int moves[9];
+        int count = orderMoves(ply, mover, moves);
+        int bestScore = -WIN_SCORE - 1;
+        for (int m = 0; m < count; m++) {
+            int i = moves[m];
+            makeSearchMove(i, mover);
+            int score = -negamax(ply + 1, -beta, -alpha, other, mover);
+            undoSearchMove(i, mover);
+            bestScore = max(bestScore, score);
+            alpha = max(alpha, score);
+            if (alpha >= beta) {
+                if (killerMoves[ply][0] != i) {
+                    killerMoves[ply][1] = killerMoves[ply][0];
+                    killerMoves[ply][0] = i;
+                }
+                historyScore[mover == 'X' ? 0 : 1][i] += 1;
+                break;
+            }
+        }
+        
+        bound = bestScore <= alphaOrig ? BOUND_UPPER : (bestScore >= beta ? BOUND_LOWER : BOUND_EXACT);
+        int stored = bestScore > 0 ? bestScore + ply : (bestScore < 0 ? bestScore - ply : 0);
+        transpositions.store(key, stored, bound);
+        return bestScore;
+    }
+    
+    // Original exhaustive search (+1/0/-1, no pruning), kept as the baseline
+    // for node-count comparisons in --search-report
+    int referenceMinimax(bool isMaximizing, char computer, char player, long long& nodes) {
+        nodes++;
+        char winner = checkWinner();
+        if (winner == computer) return 1; // Computer wins
+        if (winner == player) return -1;  // Player wins
+        if (isTie()) return 0;            // It's a tie
+        
+        int bestScore = isMaximizing ? -1000 : 1000;
+        for (int i = 0; i < 9; i++) {
+            if (board.isEmpty(i)) {
+                board.place(i, isMaximizing ? computer : player);
+                int score = referenceMinimax(!isMaximizing, computer, player, nodes);
+                board.remove(i);
+                bestScore = isMaximizing ? max(score, bestScore) : min(score, bestScore);
+            }
+        }
+        return bestScore;
+    }
+    
+    // Nodes searched by the reference minimax vs alpha-beta for a few positions
+    void searchReport() {
+        struct Sample { const char* name; uint16_t x, o; char toMove; };
+        const Sample samples[] = {
+            {"empty board", 0x000, 0x000, 'X'},
+            {"X corner", 0x001, 0x000, 'O'},
+            {"X center, O corner", 0x010, 0x001, 'X'},
+            {"midgame", 0x011, 0x104, 'X'},
+        };
+        cout << left << setw(22) << "position" << right << setw(12) << "reference" << setw(12) << "alphabeta"
+             << setw(10) << "ratio" << "\n";
+        for (const Sample& sample : samples) {
+            char other = (sample.toMove == 'X' ? 'O' : 'X');
+            board = BitBoard::fromMasks(sample.x, sample.o);
+            long long referenceNodes = 0;
+            for (int i = 0; i < 9; i++) {
+                if (board.isEmpty(i)) {
+                    board.place(i, sample.toMove);
+                    referenceMinimax(false, sample.toMove, other, referenceNodes);
+                    board.remove(i);
+                }
+            }
+            transpositions.clear();
+            resetSearchHeuristics();
+            searchNodes = 0;
+            minimaxMove(sample.toMove, other);
+            cout << left << setw(22) << sample.name << right << setw(12) << referenceNodes << setw(12) << searchNodes
+                 << setw(9) << fixed << setprecision(1) << (double)referenceNodes / max(searchNodes, 1LL) << "x\n";
+        }
+        clearBoard();
+    }
+    
+    char checkWinner() {
+        return board.winner();
+    }
+    
+    bool isTie() {
+        return board.isFull();
+    }
+    
+    void displayWinner(char winner, string player1Name, string player2Name) {
+        clearScreen();
+        printHeader();
+        drawAdvancedBoard();
+        
+        cout << BOLD << BG_GREEN << WHITE << "========================================\n" << RESET;
+        if (winner == 'X') {
+            cout << BOLD << GREEN << "*** CONGRATULATIONS! ***\n" << RESET;
+            cout << BOLD << RED << "*** " << player1Name << " WINS! ***\n" << RESET;
+            playSound("win");
+            showCelebration();
+        } else if (winner == 'O') {
+            if (player2Name == "Computer") {
+                cout << BOLD << RED << "*** COMPUTER WINS! ***\n" << RESET;
+                playSound("lose");
+                showDefeatMessage();
+            } else {
+                cout << BOLD << GREEN << "*** CONGRATULATIONS! ***\n" << RESET;
+                cout << BOLD << GREEN << "*** " << player2Name << " WINS! ***\n" << RESET;
+                playSound("win");
+                showCelebration();
+            }
+        }
+        cout << BOLD << BG_GREEN << WHITE << "========================================\n" << RESET;
+        cout << "\nPress any key to continue...";
+        getch_custom();
+    }
+    
+    void displayTie() {
+        clearScreen();
+        printHeader();
+        drawAdvancedBoard();
+        cout << BOLD << BG_YELLOW << BLACK << "========================================\n" << RESET;
+        cout << BOLD << YELLOW << "*** IT'S A TIE! GREAT GAME! ***\n" << RESET;
+        cout << BOLD << BG_YELLOW << BLACK << "========================================\n" << RESET;
+        playSound("tie");
+        cout << "\nPress any key to continue...";
+        getch_custom();
+    }
+    
+    void showCelebration() {
+        cout << BOLD << MAGENTA << "    * * * VICTORY ACHIEVED! * * *\n" << RESET;
+        cout << BOLD << CYAN << "  Excellent gameplay! Well done!\n" << RESET;
+        // Simple animation
+        for (int i = 0; i < 3; ++i) {
+            cout << YELLOW << "  \\(^_^)/ " << RESET << flush;
+            customSleep(200);
+            cout << "\r" << "          " << flush; // Clear line
+            cout << GREEN << "  \\(^_^)/ " << RESET << flush;
+            customSleep(200);
+            cout << "\r" << "          " << flush; // Clear line
+        }
+        cout << "\n";
+    }
+
+    void showDefeatMessage() {
+        cout << BOLD << RED << "    (>_<)   OH NO! YOU LOST!   (>_<)\n" << RESET;
+        cout << BOLD << WHITE << "  Better luck next time!\n" << RESET;
+        // Simple animation
+        for (int i = 0; i < 3; ++i) {
+            cout << RED << "  (x_x) " << RESET << flush;
+            customSleep(200);
+            cout << "\r" << "        " << flush; // Clear line
+            cout << WHITE << "  (o_o) " << RESET << flush;
+            customSleep(200);
+            cout << "\r" << "        " << flush; // Clear line
+        }
+        cout << "\n";
+    }
+    
+    void updateGameHistory(GameMode mode, const string& playerX, const string& playerO, int level, GameResult result) {
+        GameRecord record = {};
+        record.timestamp = (int64_t)time(0);
+        record.seed = (mode == MODE_VS_COMPUTER || mode == MODE_ULTIMATE) ? gameSeed : 0;
+        record.setPlayers(playerX, playerO);
+        record.mode = mode;
+        record.level = (uint8_t)level;
+        record.result = result;
+        if (mode == MODE_VS_COMPUTER || mode == MODE_MULTIPLAYER) {
+            for (int i = 0; i < currentMoveCount; i++) record.addMove(currentMoves[i]);
+        }
+        PlayerRegistry& registry = ratedPlayers(); // Before the append, or the replay would count this game twice
+        gameLog.append(record);
+        recentGames.push(record);
+        registry.recordGame(record);
+        if (gameLog.size() - playersSavedAt >= PLAYER_SNAPSHOT_INTERVAL) savePlayers();
+    }
+    
+    void showStatistics() {
+        clearScreen();
         printHeader();
-        drawAdvancedBoard();
+        cout << BOLD << YELLOW << "*** GAME STATISTICS ***\n\n" << RESET;
         
-        cout << BOLD << BG_GREEN << WHITE << "========================================\n" << RESET;
-        if (winner == 'X') {
-            cout << BOLD << GREEN << "*** CONGRATULATIONS! ***\n" << RESET;
-            cout << BOLD << RED << "*** " << player1Name << " WINS! ***\n" << RESET;
-            playSound("win");
-            showCelebration();
-        } else if (winner == 'O') {
-            if (player2Name == "Computer") {
-                cout << BOLD << RED << "*** COMPUTER WINS! ***\n" << RESET;
-                playSound("lose");
-                showDefeatMessage();
+        const size_t leaderboardSize = 10;
+        cout << BOLD << CYAN << "----------------------------------------\n" << RESET;
+        cout << BOLD << WHITE << "        LEADERBOARD (TOP " << leaderboardSize << " BY ELO)        \n" << RESET;
+        cout << BOLD << CYAN << "----------------------------------------\n" << RESET;
+        
+        PlayerRegistry& players = ratedPlayers();
+        vector<const PlayerStats*> leaders = players.top(leaderboardSize);
+        if (leaders.empty()) {
+            cout << "No games played yet.\n\n";
+        } else {
+            for (size_t rank = 0; rank < leaders.size(); rank++) {
+                const PlayerStats& p = *leaders[rank];
+                cout << setw(3) << (rank + 1) << ". " << (p.computer ? CYAN : (rank == 0 ? YELLOW : GREEN)) << left << setw(22) << p.name << RESET
+                     << right << BOLD << setw(6) << fixed << setprecision(0) << p.rating << RESET
+                     << "  W " << p.wins << " / L " << p.losses << " / T " << p.ties
+                     << "  (" << setprecision(1) << p.winRate << "%)\n";
+            }
+            cout << "\n   Registered players: " << players.size() << " (" << CYAN << "cyan" << RESET << " = computer)\n\n";
+        }
+        
+        // The last game's players, wherever they rank
+        if (!recentGames.empty()) {
+            cout << BOLD << "Last game:\n" << RESET;
+            for (char side : {'X', 'O'}) {
+                const PlayerStats* p = players.find(ratedPlayerName(recentGames.newest(), side), isComputerSide(recentGames.newest(), side));
+                if (!p) continue;
+                cout << "   " << (side == 'X' ? RED : GREEN) << p->name << RESET << ": Elo " << fixed << setprecision(0) << p->rating
+                     << " | Wins: " << p->wins << " | Losses: " << p->losses << " | Ties: " << p->ties
+                     << " | Win Rate: " << setprecision(1) << p->winRate << "%\n";
+            }
+            cout << "\n";
+        }
+        
+        cout << BOLD << "Total Games Played: " << totalGamesPlayed << "\n" << RESET;
+        
+        if (gameLog.isOpen()) {
+            cout << BOLD << CYAN << "\n----------------------------------------\n" << RESET;
+            cout << BOLD << WHITE << "          ALL-TIME (SAVED GAMES)        \n" << RESET;
+            cout << BOLD << CYAN << "----------------------------------------\n" << RESET;
+            cout << "   Games: " << gameLog.size() << " | X wins: " << gameLog.xWins()
+                 << " | O wins: " << gameLog.oWins() << " | Ties: " << gameLog.ties() << "\n";
+        }
+        
+        cout << "\nPress any key to continue...";
+        getch_custom();
+    }
+    
+    // Live counters and timing histograms from every thread this session,
+    // with JSON / Prometheus dumps for dashboards
+    void showEngineStats() {
+        while (true) {
+            clearScreen();
+            printHeader();
+            MetricsSnapshot snap = Metrics::global().snapshot();
+            const uint64_t* c = snap.counters;
+            auto ratio = [](uint64_t part, uint64_t whole) { return whole ? 100.0 * part / whole : 0.0; };
+            auto timing = [](const HistogramSnapshot& h, const char* unit) {
+                ostringstream line;
+                line << fixed << setprecision(1) << "avg " << h.mean() << " " << unit << " | p50 " << h.percentile(0.5)
+                     << " | p95 " << h.percentile(0.95) << " | p99 " << h.percentile(0.99) << " | max " << h.max
+                     << " (" << h.count << " samples)";
+                return line.str();
+            };
+            
+            cout << BOLD << YELLOW << "*** ENGINE STATS (this session, " << snap.shards << " threads) ***\n\n" << RESET;
+            cout << BOLD << CYAN << "AI\n" << RESET;
+            cout << "   Moves: " << c[COUNTER_AI_MOVES] << " | time " << timing(snap.histograms[HIST_AI_MOVE_US], "us") << "\n";
+            cout << "   Book hits: " << c[COUNTER_BOOK_HITS] << " | Solved-table moves: " << c[COUNTER_SOLVED_HITS] << " | Pondered replies used: " << c[COUNTER_PONDER_HITS]
+                 << " / " << (c[COUNTER_PONDER_HITS] + c[COUNTER_PONDER_MISSES]) << "\n";
+            cout << BOLD << CYAN << "Search (big boards)\n" << RESET;
+            cout << "   Searches: " << c[COUNTER_SEARCHES] << " | Nodes: " << c[COUNTER_SEARCH_NODES]
+                 << " | Branching factor: " << fixed << setprecision(2)
+                 << (c[COUNTER_SEARCH_EXPANDED] ? (double)c[COUNTER_SEARCH_NODES] / c[COUNTER_SEARCH_EXPANDED] : 0.0) << "\n";
+            cout << "   Depth: " << timing(snap.histograms[HIST_SEARCH_DEPTH], "plies") << "\n";
+            cout << "   TT hit rate: " << setprecision(1) << ratio(c[COUNTER_TT_HITS], c[COUNTER_TT_HITS] + c[COUNTER_TT_MISSES])
+                 << "% (" << c[COUNTER_TT_HITS] << " hits, " << c[COUNTER_TT_MISSES] << " misses)\n";
+            cout << "   MCTS playouts: " << c[COUNTER_MCTS_PLAYOUTS] << "\n";
+            cout << BOLD << CYAN << "Terminal\n" << RESET;
+            cout << "   Frames: " << c[COUNTER_FRAMES] << " | " << setprecision(0)
+                 << (c[COUNTER_FRAMES] ? (double)c[COUNTER_FRAME_BYTES] / c[COUNTER_FRAMES] : 0.0) << " bytes/frame\n";
+            cout << "   Render: " << timing(snap.histograms[HIST_RENDER_US], "us") << "\n";
+            cout << "   Input wait: " << timing(snap.histograms[HIST_INPUT_WAIT_MS], "ms") << "\n";
+            
+            cout << "\n" << BOLD << "j" << RESET << " = save " << METRICS_JSON_FILE << ", " << BOLD << "p" << RESET
+                 << " = save " << METRICS_PROMETHEUS_FILE << ", any other key = back: ";
+            char key = getch_custom();
+            if (key != 'j' && key != 'J' && key != 'p' && key != 'P') return;
+            bool json = (key == 'j' || key == 'J');
+            const char* path = json ? METRICS_JSON_FILE : METRICS_PROMETHEUS_FILE;
+            FILE* file = fopen(path, "w");
+            string text = json ? metricsJson(snap) + "\n" : metricsPrometheus(snap);
+            bool saved = file && fwrite(text.data(), 1, text.size(), file) == text.size();
+            if (file) fclose(file);
+            cout << "\n" << (saved ? GREEN : RED) << (saved ? "Saved " : "Could not write ") << path << RESET << "\n";
+            customSleep(1000);
+        }
+    }
+    
+    // Pages through the game log newest first (or this session's games if the
+    // log could not be opened); text is built only for the visible page
+    void showGameHistory() {
+        const uint64_t pageSize = 10;
+        uint64_t page = 0;
+        bool fromLog = gameLog.isOpen();
+        while (true) {
+            clearScreen();
+            printHeader();
+            uint64_t total = fromLog ? gameLog.size() : recentGames.size();
+            uint64_t pages = max<uint64_t>(1, (total + pageSize - 1) / pageSize);
+            cout << BOLD << YELLOW << "*** GAME HISTORY (" << total << " games, page " << (page + 1) << "/" << pages << ") ***\n\n" << RESET;
+            
+            if (!fromLog) {
+                cout << RED << "Game log " << GAME_LOG_FILE << " could not be opened; showing the last "
+                     << recentGames.capacity() << " games of this session.\n\n" << RESET;
+            }
+            if (total == 0) {
+                cout << RED << "No games played yet!\n" << RESET;
+            } else {
+                for (uint64_t n = page * pageSize; n < min(total, (page + 1) * pageSize); n++) {
+                    const GameRecord& record = fromLog ? gameLog.at(total - 1 - n) : recentGames.newest(n);
+                    cout << (n + 1) << ". " << GREEN << describeGameRecord(record) << RESET << "\n";
+                }
+            }
+            
+            cout << "\n" << BOLD << "[N]ext page, [P]revious page, any other key to return" << RESET;
+            char key = getch_custom();
+            if ((key == 'n' || key == 'N') && page + 1 < pages) page++;
+            else if ((key == 'p' || key == 'P') && page > 0) page--;
+            else if (key != 'n' && key != 'N' && key != 'p' && key != 'P') break;
+        }
+    }
+    
+    bool playAgain() {
+        cout << BOLD << "\nPlay another round? (y/n): " << RESET;
+        string answer = terminal.readLine();
+        playSound("select");
+        char choice = answer.empty() ? 'n' : answer[0];
+        return (choice == 'y' || choice == 'Y');
+    }
+    
+    void playVsComputer() {
+        string playerName;
+        playerName = readPlayerName("Enter your name: ");
+        
+        int difficulty = getDifficultyLevel();
+        string difficultyName[] = {"", "Easy", "Medium", "Hard", "Impossible"};
+        cout << BOLD << "\nStarting game against " << CYAN << difficultyName[difficulty] << RESET << " AI...\n" << RESET;
+        customSleep(1500);
+        
+        do {
+            clearBoard();
+            bool gameRunning = true;
+            totalGamesPlayed++;
+            gameSeed = seedSource.next64();
+            gameRng.reseed(gameSeed);
+            rngAtPly[0] = gameRng;
+            
+            while (gameRunning) {
+                writeHeader(frame.canvas);
+                frame.canvas << BOLD << "Mode: " << GREEN << "VS Computer (" << difficultyName[difficulty] << ")\n" << RESET;
+                frame.canvas << BOLD << "Player: " << RED << playerName << RESET << " (X) vs " << GREEN << "Computer" << RESET << " (O)\n" << RESET;
+                drawAdvancedBoard(frame.canvas);
+                frame.present();
+                
+                if (board.sideToMove() == 'X') {
+                    startPondering('O', 'X', difficulty);
+                    bool moved = playerMove('X', playerName, 2);
+                    ponder.finish();
+                    if (!moved) continue; // Undo/redo: redraw
+                } else {
+                    computerMove('O', 'X', difficulty);
+                }
+                
+                char winner = checkWinner();
+                if (winner == ' ' && !isTie()) continue;
+                if (winner == ' ') displayTie();
+                else displayWinner(winner, playerName, "Computer");
+                updateGameHistory(MODE_VS_COMPUTER, playerName, "Computer", difficulty,
+                                  winner == 'X' ? RESULT_X_WINS : (winner == 'O' ? RESULT_O_WINS : RESULT_TIE));
+                gameRunning = false;
+            }
+        } while (playAgain());
+    }
+    
+    void playMultiplayer() {
+        string player1Name, player2Name;
+        player1Name = readPlayerName("Enter Player 1 name (X): ");
+        player2Name = readPlayerName("Enter Player 2 name (O): ");
+        
+        do {
+            clearBoard();
+            bool gameRunning = true;
+            totalGamesPlayed++;
+            
+            while (gameRunning) {
+                writeHeader(frame.canvas);
+                frame.canvas << BOLD << "Mode: " << CYAN << "Multiplayer\n" << RESET;
+                frame.canvas << BOLD << RED << player1Name << RESET << " (X) vs " << GREEN << player2Name << RESET << " (O)\n" << RESET;
+                drawAdvancedBoard(frame.canvas);
+                frame.present();
+                
+                char turn = board.sideToMove();
+                if (!playerMove(turn, turn == 'X' ? player1Name : player2Name, 1)) continue; // Undo/redo: redraw
+                
+                char winner = checkWinner();
+                if (winner == ' ' && !isTie()) continue;
+                if (winner == ' ') displayTie();
+                else displayWinner(winner, player1Name, player2Name);
+                updateGameHistory(MODE_MULTIPLAYER, player1Name, player2Name, 0,
+                                  winner == 'X' ? RESULT_X_WINS : (winner == 'O' ? RESULT_O_WINS : RESULT_TIE));
+                gameRunning = false;
+            }
+        } while (playAgain());
+    }
+    
+    template <int N, int K>
+    void drawGridBoard(const GridBoard<N, K>& grid, ostream& out = cout) {
+        out << BOLD << CYAN << "\n     * " << N << "x" << N << " BOARD (" << K << " in a row) *\n\n" << RESET;
+        out << "    ";
+        for (int c = 1; c <= N; c++) out << BLUE << setw(3) << c << RESET;
+        out << "\n";
+        for (int r = 0; r < N; r++) {
+            out << BLUE << setw(3) << (r + 1) << " " << RESET;
+            for (int c = 0; c < N; c++) {
+                char cell = grid.at(r * N + c);
+                out << "  " << cellColor(cell) << (cell == ' ' ? '.' : cell) << RESET;
+            }
+            out << "\n";
+        }
+        out << '\n';
+    }
+    
+    template <int N, int K>
+    void gridPlayerMove(GridBoard<N, K>& grid, string playerName, int& lastMove, const std::function<string()>& status = nullptr) {
+        int row, col;
+        while (true) {
+            if (status) cout << CYAN << status() << RESET << "\n";
+            cout << BOLD << "Player " << RED << playerName << RESET << " (" << RED << 'X' << RESET << "), enter row and column (1-" << N << "): " << RESET;
+            istringstream line(terminal.readLine(statusRefresher(status)));
+            if (!(line >> row >> col)) {
+                cout << RED << "Invalid input! Please enter two numbers.\n" << RESET;
+                customSleep(500);
+                continue;
+            }
+            if (row < 1 || row > N || col < 1 || col > N) {
+                cout << RED << "Invalid position! Choose 1-" << N << ".\n" << RESET;
+                customSleep(500);
+                continue;
+            }
+            int cell = (row - 1) * N + (col - 1);
+            if (!grid.isEmpty(cell)) {
+                cout << RED << "Position occupied! Try another spot.\n" << RESET;
+                customSleep(500);
+                continue;
+            }
+            grid.place(cell, 'X');
+            lastMove = cell;
+            playSound("move");
+            break;
+        }
+    }
+    
+    template <int N, int K>
+    void playGridVsComputer(const string& playerName, int budgetMs) {
+        GridBoard<N, K> grid;
+        GridEngine<N, K> engine;
+        GridEngine<N, K> ponderEngine; // Own tables: searches while the player types
+        Ponderer<typename GridEngine<N, K>::SearchResult> ponder;
+        OpeningBook book;
+        book.open(openingBookPath(N, K), N, K); // Only mapped; pages load on first probe
+        SolvedTable oracle; // 4x4 only, once --solve has finished it
+        std::unique_ptr<SolverGeometry> geometry;
+        if (oracle.open(solvedTablePath(N, K), N, K) && oracle.isComplete()) geometry.reset(new SolverGeometry(N, K));
+        string modeName = to_string(N) + "x" + to_string(N);
+        
+        do {
+            grid.clear();
+            totalGamesPlayed++;
+            char turn = 'X';
+            int lastMove = -1;
+            string lastInfo;
+            
+            while (true) {
+                writeHeader(frame.canvas);
+                frame.canvas << BOLD << "Mode: " << YELLOW << "Big Board " << modeName << "\n" << RESET;
+                frame.canvas << BOLD << "Player: " << RED << playerName << RESET << " (X) vs " << GREEN << "Computer" << RESET << " (O)\n" << RESET;
+                drawGridBoard(grid, frame.canvas);
+                if (!lastInfo.empty()) frame.canvas << CYAN << lastInfo << RESET << "\n";
+                frame.present();
+                
+                if (turn == 'X') {
+                    // Likely replies first: closest to the computer's last stone (or the center)
+                    int focus = lastMove >= 0 ? lastMove : (N / 2) * N + N / 2;
+                    vector<int> moves;
+                    for (int i = 0; i < N * N && !geometry; i++) { // Nothing to ponder with a solved table
+                        if (isCandidateMove(grid, i)) moves.push_back(i);
+                    }
+                    stable_sort(moves.begin(), moves.end(), [focus](int a, int b) {
+                        return max(abs(a / N - focus / N), abs(a % N - focus % N)) <
+                               max(abs(b / N - focus / N), abs(b % N - focus % N));
+                    });
+                    GridBoard<N, K> position = grid;
+                    GridEngine<N, K>* searcher = &ponderEngine;
+                    ponder.start(moves, [position, searcher, budgetMs](int human, const std::atomic<bool>& stop,
+                                                                       typename GridEngine<N, K>::SearchResult& reply) {
+                        GridBoard<N, K> next = position;
+                        next.place(human, 'X');
+                        if (next.winsAt(human, 'X') || next.isFull()) return false;
+                        reply = searcher->findBestMove(next, 'O', budgetMs, GridEngine<N, K>::CELLS, &stop);
+                        return !stop.load();
+                    });
+                    std::function<string()> status;
+                    if (!moves.empty()) {
+                        status = [&ponder]() {
+                            return "AI pondering: " + to_string(ponder.readyCount()) + "/" + to_string(ponder.candidateCount()) + " replies ready";
+                        };
+                    }
+                    gridPlayerMove(grid, playerName, lastMove, status);
+                    ponder.finish();
+                } else {
+                    cout << BOLD << YELLOW << "Computer is thinking..." << RESET << "\n" << flush;
+                    MetricTimer thinking(HIST_AI_MOVE_US);
+                    Metrics::add(COUNTER_AI_MOVES);
+                    int bookValue = 0, bookDepth = 0, solvedValue = 0;
+                    int move = geometry ? probeSolvedTable(oracle, *geometry, grid, 'O', &solvedValue) : -1;
+                    bool solved = move >= 0;
+                    if (!solved) move = probeOpeningBook(book, grid, 'O', &bookValue, &bookDepth);
+                    string detail;
+                    const typename GridEngine<N, K>::SearchResult* pondered = ponder.replyTo(lastMove);
+                    if (solved) {
+                        detail = solvedValue == SOLVED_WIN ? "solved: winning" : "solved: drawing";
+                        Metrics::add(COUNTER_SOLVED_HITS);
+                    } else if (move >= 0) {
+                        detail = bookDepth == BOOK_SOLVED_DEPTH ? "book, solved, value " + to_string(bookValue)
+                                                                : "book, depth " + to_string(bookDepth) + ", value " + to_string(bookValue);
+                        Metrics::add(COUNTER_BOOK_HITS);
+                    } else if (pondered) {
+                        move = pondered->move;
+                        Metrics::add(COUNTER_PONDER_HITS);
+                        detail = "pondered, depth " + to_string(pondered->depth) + ", " + to_string(pondered->nodes) + " nodes";
+                    } else {
+                        Metrics::add(COUNTER_PONDER_MISSES);
+                        typename GridEngine<N, K>::SearchResult result = engine.findBestMove(grid, 'O', budgetMs);
+                        move = result.move;
+                        detail = "depth " + to_string(result.depth) + ", " + to_string(result.nodes) + " nodes, " +
+                                 to_string((int)result.elapsedMs) + " ms";
+                    }
+                    grid.place(move, 'O');
+                    lastMove = move;
+                    playSound("move");
+                    lastInfo = "Computer chose row " + to_string(move / N + 1) + ", column " + to_string(move % N + 1) +
+                               " (" + detail + ")";
+                }
+                
+                if (grid.winsAt(lastMove, turn)) {
+                    clearScreen();
+                    printHeader();
+                    drawGridBoard(grid);
+                    bool playerWon = (turn == 'X');
+                    cout << BOLD << (playerWon ? GREEN : RED) << "*** " << (playerWon ? playerName : string("COMPUTER")) << " WINS! ***\n" << RESET;
+                    playSound(playerWon ? "win" : "lose");
+                    if (playerWon) showCelebration(); else showDefeatMessage();
+                    updateGameHistory(MODE_BIG_BOARD, playerName, "Computer", N, playerWon ? RESULT_X_WINS : RESULT_O_WINS);
+                    break;
+                }
+                if (grid.isFull()) {
+                    clearScreen();
+                    printHeader();
+                    drawGridBoard(grid);
+                    cout << BOLD << YELLOW << "*** IT'S A TIE! GREAT GAME! ***\n" << RESET;
+                    playSound("tie");
+                    updateGameHistory(MODE_BIG_BOARD, playerName, "Computer", N, RESULT_TIE);
+                    break;
+                }
+                turn = (turn == 'X' ? 'O' : 'X');
+            }
+        } while (playAgain());
+    }
+    
+    void playBigBoard() {
+        int size;
+        printHeader();
+        cout << BOLD << YELLOW << "*** SELECT BOARD SIZE ***\n\n" << RESET;
+        cout << "1. " << GREEN << "4x4 (4 in a row)\n" << RESET;
+        cout << "2. " << CYAN << "5x5 (4 in a row)\n" << RESET;
+        cout << "3. " << MAGENTA << "15x15 Gomoku (5 in a row)\n\n" << RESET;
+        do {
+            cout << BOLD << "Choose board (1-3): " << RESET;
+            size = terminal.readNumber();
+            playSound("select");
+            if (size < 1 || size > 3) {
+                cout << RED << "Invalid choice! Please select 1-3.\n" << RESET;
+            }
+        } while (size < 1 || size > 3);
+        
+        string playerName;
+        playerName = readPlayerName("Enter your name: ");
+        
+        if (size == 1) playGridVsComputer<4, 4>(playerName, GRID_MOVE_BUDGET_MS);
+        else if (size == 2) playGridVsComputer<5, 4>(playerName, GRID_MOVE_BUDGET_MS);
+        else playGridVsComputer<15, 5>(playerName, GRID_MOVE_BUDGET_MS);
+    }
+    
+    // Sub-boards are separated by double lines; open cells of the sub-board(s)
+    // the mover may play in are highlighted
+    void drawUltimateBoard(const UltimateBoard& game, ostream& out = cout) {
+        out << BOLD << CYAN << "\n     * ULTIMATE BOARD *\n\n" << RESET;
+        for (int row = 0; row < 9; row++) {
+            if (row > 0 && row % 3 == 0) out << BLUE << "    =======++=======++======\n" << RESET;
+            out << BLUE << "    " << RESET;
+            for (int col = 0; col < 9; col++) {
+                if (col > 0 && col % 3 == 0) out << BLUE << " ||" << RESET;
+                int b = (row / 3) * 3 + col / 3, c = (row % 3) * 3 + col % 3;
+                char cell = game.cells[b].at(c);
+                bool playable = game.isLegal(b * 9 + c);
+                if (cell != ' ') out << ' ' << cellColor(cell) << cell << RESET;
+                else out << ' ' << (playable ? YELLOW : WHITE) << (playable ? '*' : '.') << RESET;
+            }
+            out << "\n";
+        }
+        out << "\n" << BOLD << "Sub-boards: " << RESET;
+        for (int b = 0; b < 9; b++) {
+            char owner = game.macro.at(b);
+            out << (b + 1) << "=" << cellColor(owner) << (owner != ' ' ? owner : ((game.closed >> b & 1) ? '-' : '.')) << RESET << " ";
+        }
+        out << "\n";
+        if (game.forced >= 0) out << YELLOW << "Play in sub-board " << (game.forced + 1) << "\n" << RESET;
+        else out << YELLOW << "Play in any open sub-board\n" << RESET;
+        out << '\n';
+    }
+    
+    void ultimatePlayerMove(UltimateBoard& game, string playerName) {
+        int sub, cell;
+        while (true) {
+            cout << BOLD << "Player " << RED << playerName << RESET << " (" << RED << 'X' << RESET << "), enter sub-board and cell (1-9 1-9): " << RESET;
+            istringstream line(terminal.readLine());
+            if (!(line >> sub >> cell)) {
+                cout << RED << "Invalid input! Please enter two numbers.\n" << RESET;
+                customSleep(500);
+                continue;
+            }
+            int move = (sub - 1) * 9 + (cell - 1);
+            if (sub < 1 || sub > 9 || cell < 1 || cell > 9) {
+                cout << RED << "Invalid position! Choose 1-9.\n" << RESET;
+            } else if (game.forced >= 0 && game.forced != sub - 1) {
+                cout << RED << "You must play in sub-board " << (game.forced + 1) << "!\n" << RESET;
+            } else if (!game.isLegal(move)) {
+                cout << RED << "That spot is taken or its sub-board is closed! Try another.\n" << RESET;
+            } else {
+                game.play(move);
+                playSound("move");
+                break;
+            }
+            customSleep(500);
+        }
+    }
+    
+    void playUltimate() {
+        string playerName;
+        playerName = readPlayerName("Enter your name: ");
+        
+        const int budgetMs = 1000; // Per computer move
+        UltimateBoard game;
+        UltimateMcts engine;
+        
+        do {
+            game.clear();
+            totalGamesPlayed++;
+            gameSeed = seedSource.next64();
+            uint64_t searchSeed = gameSeed; // One MCTS seed per computer move, derived from the game's
+            string lastInfo;
+            
+            while (!game.isOver()) {
+                writeHeader(frame.canvas);
+                frame.canvas << BOLD << "Mode: " << MAGENTA << "Ultimate Tic-Tac-Toe\n" << RESET;
+                frame.canvas << BOLD << "Player: " << RED << playerName << RESET << " (X) vs " << GREEN << "Computer" << RESET << " (O)\n" << RESET;
+                drawUltimateBoard(game, frame.canvas);
+                if (!lastInfo.empty()) frame.canvas << CYAN << lastInfo << RESET << "\n";
+                frame.present();
+                
+                if (game.toMove == 'X') {
+                    ultimatePlayerMove(game, playerName);
+                } else {
+                    cout << BOLD << YELLOW << "Computer is thinking..." << RESET << "\n" << flush;
+                    UltimateMcts::SearchResult result;
+                    {
+                        MetricTimer thinking(HIST_AI_MOVE_US);
+                        result = engine.findBestMove(game, budgetMs, searchSeed++);
+                    }
+                    Metrics::add(COUNTER_AI_MOVES);
+                    game.play(result.move);
+                    playSound("move");
+                    ostringstream info;
+                    info << "Computer chose sub-board " << (result.move / 9 + 1) << ", cell " << (result.move % 9 + 1)
+                         << " (" << result.playouts << " playouts, "
+                         << (long long)(result.playouts * 1000.0 / max(result.elapsedMs, 1.0)) << " playouts/s on "
+                         << result.threads << " threads, win " << fixed << setprecision(0) << result.winRate * 100 << "%)";
+                    lastInfo = info.str();
+                }
+            }
+            
+            clearScreen();
+            printHeader();
+            drawUltimateBoard(game);
+            char winner = game.winner();
+            int result = (winner == 'X') ? 1 : (winner == 'O' ? -1 : 0);
+            if (winner == ' ') {
+                cout << BOLD << YELLOW << "*** IT'S A TIE! GREAT GAME! ***\n" << RESET;
+                playSound("tie");
+            } else {
+                cout << BOLD << (result > 0 ? GREEN : RED) << "*** " << (result > 0 ? playerName : string("COMPUTER")) << " WINS! ***\n" << RESET;
+                playSound(result > 0 ? "win" : "lose");
+                if (result > 0) showCelebration(); else showDefeatMessage();
+            }
+            updateGameHistory(MODE_ULTIMATE, playerName, "Computer", 0,
+                              winner == 'X' ? RESULT_X_WINS : (winner == 'O' ? RESULT_O_WINS : RESULT_TIE));
+        } while (playAgain());
+    }
+    
+    void run() {
+        terminal.begin(); // Raw mode for the whole session, restored on exit
+        seedSource.reseed((uint64_t)time(0));
+        int choice;
+        
+        cout << BOLD << BG_MAGENTA << WHITE;
+        typeMessage("Initializing Bern's Tic Tac Toe Games...", 40);
+        cout << RESET << "\n";
+        
+        customSleep(1500);
+        
+        do {
+            showMenu();
+            choice = terminal.readNumber();
+            playSound("select");
+            
+            switch (choice) {
+                case 1:
+                    playVsComputer();
+                    break;
+                case 2:
+                    playMultiplayer();
+                    break;
+                case 3:
+                    showStatistics();
+                    break;
+                case 4:
+                    soundEnabled = !soundEnabled;
+                    cout << BOLD << "Sound " << (soundEnabled ? GREEN "enabled" : RED "disabled") << "!\n" << RESET;
+                    customSleep(1000);
+                    break;
+                case 5:
+                    showGameHistory();
+                    break;
+                case 6:
+                    playBigBoard();
+                    break;
+                case 7:
+                    playUltimate();
+                    break;
+                case 8:
+                    showEngineStats();
+                    break;
+                case 9:
+                    savePlayers();
+                    clearScreen();
+                    cout << BOLD << BG_BLUE << WHITE;
+                    typeMessage("Thanks for playing Bern's Tic Tac Toe Game!\n", 40);
+                    typeMessage("Come back soon for more epic battles!\n", 40);
+                    cout << RESET;
+                    customSleep(2000);
+                    break;
+                default:
+                    cout << RED << "Invalid choice! Please select 1-9.\n" << RESET;
+                    customSleep(1000);
+            }
+        } while (choice != 9);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Headless self-play simulator
+// Usage: TicTacToe --simulate <X level 1-4> <O level 1-4> <games> [threads] [seed]
+//        TicTacToe --replay <X level 1-4> <O level 1-4> <game seed>
+// Game i of a run uses seed (run seed + i), independent of the thread count.
+// ---------------------------------------------------------------------------
+
+// Plays one AI-vs-AI game and returns 'X', 'O' or ' ' for a draw.
+// If `moves` is given, the cells played are written to it in order.
+char playHeadlessGame(int levelX, int levelO, uint64_t seed, int* moves = nullptr) {
+    GameRng rng(seed);
+    BitBoard board;
+    char turn = 'X', other = 'O';
+    for (int ply = 0; ; ply++) {
+        int move = chooseAiMove(board, turn, other, turn == 'X' ? levelX : levelO, rng, &installedPolicy());
+        if (moves) moves[ply] = move;
+        board.place(move, turn);
+        if (board.winner() != ' ') return turn;
+        if (board.isFull()) return ' ';
+        swap(turn, other);
+    }
+}
+
+// One per worker, padded to a cache line so workers never share one
+struct alignas(64) SimulationTally {
+    long long xWins = 0, oWins = 0, draws = 0;
+};
+
+// Plays games [first, last) of a run a batch at a time in lockstep: after each
+// round of moves the whole batch is classified with one classifyPositions
+// call, and finished games make room for the next ones. Every game gets the
+// same seed and moves as playHeadlessGame would give it.
+SimulationTally simulateGames(int levelX, int levelO, uint64_t seed, long long first, long long last) {
+    const size_t batchSize = 64;
+    struct LiveGame {
+        BitBoard board;
+        GameRng rng;
+    };
+    vector<LiveGame> live;
+    live.reserve(batchSize);
+    uint16_t xs[batchSize], os[batchSize];
+    uint8_t classes[batchSize];
+    const LearnedPolicy& policy = installedPolicy();
+    SimulationTally tally;
+    long long next = first;
+    while (live.size() < batchSize && next < last) live.push_back(LiveGame{BitBoard(), GameRng(seed + (uint64_t)next++)});
+    while (!live.empty()) {
+        for (size_t i = 0; i < live.size(); i++) {
+            LiveGame& game = live[i];
+            char turn = game.board.sideToMove(), other = (turn == 'X' ? 'O' : 'X');
+            game.board.place(chooseAiMove(game.board, turn, other, turn == 'X' ? levelX : levelO, game.rng, &policy), turn);
+            xs[i] = game.board.x;
+            os[i] = game.board.o;
+        }
+        classifyPositions(xs, os, classes, live.size());
+        // Backwards, so a finished game can take the last slot's already-classified game
+        for (size_t i = live.size(); i-- > 0;) {
+            if (classes[i] == OUTCOME_ONGOING) continue;
+            if (classes[i] == OUTCOME_X_WINS) tally.xWins++;
+            else if (classes[i] == OUTCOME_O_WINS) tally.oWins++;
+            else tally.draws++;
+            if (next < last) {
+                live[i].board.clear();
+                live[i].rng.reseed(seed + (uint64_t)next++);
             } else {
-                cout << BOLD << GREEN << "*** CONGRATULATIONS! ***\n" << RESET;
-                cout << BOLD << GREEN << "*** " << player2Name << " WINS! ***\n" << RESET;
-                playSound("win");
-                showCelebration();
+                live[i] = live.back();
+                live.pop_back();
             }
         }
-        cout << BOLD << BG_GREEN << WHITE << "========================================\n" << RESET;
-        cout << "\nPress any key to continue...";
-        getch_custom();
     }
-    
-    void displayTie() {
-        clearScreen();
-        printHeader();
-        drawAdvancedBoard();
-        cout << BOLD << BG_YELLOW << BLACK << "========================================\n" << RESET;
-        cout << BOLD << YELLOW << "*** IT'S A TIE! GREAT GAME! ***\n" << RESET;
-        cout << BOLD << BG_YELLOW << BLACK << "========================================\n" << RESET;
-        playSound("tie");
-        cout << "\nPress any key to continue...";
-        getch_custom();
+    return tally;
+}
+
+int runSimulation(int argc, char* argv[]) {
+    if (argc < 5) {
+        cout << "Usage: " << argv[0] << " --simulate <X level 1-4> <O level 1-4> <games> [threads] [seed]\n";
+        return 1;
     }
-    
-    void showCelebration() {
-        cout << BOLD << MAGENTA << "    * * * VICTORY ACHIEVED! * * *\n" << RESET;
-        cout << BOLD << CYAN << "  Excellent gameplay! Well done!\n" << RESET;
-        // Simple animation
-        for (int i = 0; i < 3; ++i) {
-            cout << YELLOW << "  \\(^_^)/ " << RESET << flush;
-            customSleep(200);
-            cout << "\r" << "          " << flush; // Clear line
-            cout << GREEN << "  \\(^_^)/ " << RESET << flush;
-            customSleep(200);
-            cout << "\r" << "          " << flush; // Clear line
+    int levelX = atoi(argv[2]), levelO = atoi(argv[3]);
+    long long games = atoll(argv[4]);
+    int threads = (argc > 5) ? atoi(argv[5]) : (int)std::thread::hardware_concurrency();
+    uint64_t seed = (argc > 6) ? strtoull(argv[6], nullptr, 10) : (uint64_t)time(0);
+    if (levelX < 1 || levelX > 4 || levelO < 1 || levelO > 4 || games < 1) {
+        cout << RED << "Levels must be 1-4 and games must be positive.\n" << RESET;
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    vector<SimulationTally> tallies(threads);
+    vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        long long first = games * t / threads, last = games * (t + 1) / threads;
+        workers.emplace_back([&tallies, t, first, last, levelX, levelO, seed]() {
+            tallies[t] = simulateGames(levelX, levelO, seed, first, last);
+        });
+    }
+    for (std::thread& w : workers) w.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SimulationTally total;
+    for (const SimulationTally& t : tallies) {
+        total.xWins += t.xWins;
+        total.oWins += t.oWins;
+        total.draws += t.draws;
+    }
+    string levelName[] = {"", "Easy", "Medium", "Hard", "Impossible"};
+    cout << BOLD << "X (" << levelName[levelX] << ") vs O (" << levelName[levelO] << "): " << games
+         << " games on " << threads << " thread(s), seed " << seed << RESET << "\n";
+    cout << fixed << setprecision(2);
+    cout << "   X wins: " << total.xWins << " (" << 100.0 * total.xWins / games << "%)\n";
+    cout << "   O wins: " << total.oWins << " (" << 100.0 * total.oWins / games << "%)\n";
+    cout << "   Draws:  " << total.draws << " (" << 100.0 * total.draws / games << "%)\n";
+    cout << "   Time:   " << setprecision(3) << seconds << " s | " << setprecision(0) << games / max(seconds, 1e-9) << " games/s\n";
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Self-play trainer for the learned 3x3 policy (one-step Q-learning in
+// negamax form: a move's target is +1 if it wins, 0 if it fills the board,
+// else minus the opponent's best Q). Workers play epsilon-greedy games
+// against the shared table without locks, average their updates per
+// (position, move) locally and push them in batches with relaxed atomic adds.
+// Usage: TicTacToe --train [episodes] [threads] [seed] [Medium temperature] [Hard temperature]
+// ---------------------------------------------------------------------------
+
+static constexpr int Q_SCALE = 1 << 24; // Fixed point for the shared table
+
+struct PolicyTrainer {
+    vector<std::atomic<int32_t>> q;
+    std::atomic<long long> episodesDone;
+    double learningRate;
+
+    PolicyTrainer() : q((size_t)POSITION_COUNT * 9), episodesDone(0), learningRate(0.3) {
+        for (auto& v : q) v.store(0, std::memory_order_relaxed);
+    }
+
+    int32_t at(int idx, int cell) const { return q[(size_t)idx * 9 + cell].load(std::memory_order_relaxed); }
+
+    int bestMove(const BitBoard& board, int idx) const {
+        int best = -1;
+        for (int i : MOVE_ORDER) {
+            if (board.isEmpty(i) && (best < 0 || at(idx, i) > at(idx, best))) best = i;
+        }
+        return best;
+    }
+
+    void worker(long long episodes, uint64_t seed) {
+        const int batchEpisodes = 64;
+        GameRng rng(seed);
+        vector<double> sum(q.size(), 0.0);
+        vector<uint32_t> count(q.size(), 0);
+        vector<int> touched;
+        auto flush = [&]() {
+            for (int slot : touched) {
+                q[slot].fetch_add((int32_t)(sum[slot] / count[slot]), std::memory_order_relaxed);
+                sum[slot] = 0.0;
+                count[slot] = 0;
+            }
+            touched.clear();
+        };
+        for (long long e = 0; e < episodes; e++) {
+            // Explore a lot early, settle towards greedy play
+            uint32_t epsilon = (uint32_t)(1000 * (0.3 - 0.25 * e / max(episodes, 1LL)));
+            BitBoard board;
+            while (!board.isTerminal()) {
+                int idx = positionIndex(board.x, board.o);
+                char mover = board.sideToMove();
+                int move = bestMove(board, idx);
+                if (rng.below(1000) < epsilon) move = randomEmptyCell(board, rng);
+                board.place(move, mover);
+                double target;
+                if (board.winsAt(move, mover)) target = 1.0;
+                else if (board.isFull()) target = 0.0;
+                else target = -(double)at(positionIndex(board.x, board.o), bestMove(board, positionIndex(board.x, board.o))) / Q_SCALE;
+                int slot = idx * 9 + move;
+                if (count[slot]++ == 0) touched.push_back(slot);
+                sum[slot] += learningRate * (target * Q_SCALE - at(idx, move));
+            }
+            if ((e + 1) % batchEpisodes == 0) {
+                flush();
+                episodesDone.fetch_add(batchEpisodes, std::memory_order_relaxed);
+            }
+        }
+        flush();
+        episodesDone.fetch_add(episodes % batchEpisodes, std::memory_order_relaxed);
+    }
+
+    vector<int8_t> quantize() const {
+        vector<int8_t> values(q.size(), LearnedPolicy::NO_VALUE);
+        for (int idx = 0; idx < POSITION_COUNT; idx++) {
+            uint16_t x = 0, o = 0;
+            for (int i = 0, rest = idx; i < 9; i++, rest /= 3) {
+                if (rest % 3 == 1) x |= (uint16_t)(1u << i);
+                else if (rest % 3 == 2) o |= (uint16_t)(1u << i);
+            }
+            for (int i = 0; i < 9; i++) {
+                if ((x | o) >> i & 1) continue;
+                double v = (double)at(idx, i) / Q_SCALE;
+                values[(size_t)idx * 9 + i] = (int8_t)lround(max(-1.0, min(1.0, v)) * 127);
+            }
+        }
+        return values;
+    }
+};
+
+// Share of non-terminal positions where the policy's best move keeps the
+// game-theoretic value (checked against the perfect-play table)
+double policyAccuracy(const LearnedPolicy& policy) {
+    int positions = 0, correct = 0;
+    for (int idx = 0; idx < POSITION_COUNT; idx++) {
+        BitBoard board;
+        int xCount = 0, oCount = 0;
+        for (int i = 0, rest = idx; i < 9; i++, rest /= 3) {
+            if (rest % 3 == 1) { board.place(i, 'X'); xCount++; }
+            else if (rest % 3 == 2) { board.place(i, 'O'); oCount++; }
+        }
+        if ((xCount != oCount && xCount != oCount + 1) || board.isTerminal()) continue;
+        GameRng unused;
+        int move = policy.chooseMove(board, 0, unused);
+        int childWeight = (board.sideToMove() == 'X' ? 1 : 2) * TERNARY.weight[1u << move];
+        positions++;
+        if (-PERFECT_PLAY.value(idx + childWeight) == PERFECT_PLAY.value(idx)) correct++;
+    }
+    return 100.0 * correct / max(positions, 1);
+}
+
+// Policy at `temperature` (or, without a policy, the rules of `level`) against
+// a built-in level; returns wins/draws/losses for the tested side
+SimulationTally playPolicyMatch(const LearnedPolicy* policy, double temperature, int level, int opponentLevel, int games,
+                                uint64_t seed) {
+    SimulationTally tally;
+    for (int g = 0; g < games; g++) {
+        GameRng rng(seed + g);
+        BitBoard board;
+        char policySide = (g % 2 == 0) ? 'X' : 'O';
+        while (!board.isTerminal()) {
+            char mover = board.sideToMove();
+            char other = mover == 'X' ? 'O' : 'X';
+            int move = mover != policySide ? chooseAiMove(board, mover, other, opponentLevel, rng)
+                       : policy            ? policy->chooseMove(board, temperature, rng)
+                                           : chooseAiMove(board, mover, other, level, rng);
+            board.place(move, mover);
+        }
+        char winner = board.winner();
+        if (winner == policySide) tally.xWins++;
+        else if (winner == ' ') tally.draws++;
+        else tally.oWins++;
+    }
+    return tally;
+}
+
+int runTrainer(int argc, char* argv[]) {
+    long long episodes = (argc > 2) ? atoll(argv[2]) : 10000000;
+    int threads = (argc > 3) ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], nullptr, 10) : (uint64_t)time(0);
+    double mediumTemperature = (argc > 5) ? atof(argv[5]) : POLICY_TEMPERATURE[2];
+    double hardTemperature = (argc > 6) ? atof(argv[6]) : POLICY_TEMPERATURE[3];
+    if (episodes < 1) {
+        cout << RED << "Episodes must be positive.\n" << RESET;
+        return 1;
+    }
+    if (mediumTemperature < 0 || hardTemperature < 0) {
+        cout << RED << "Temperatures must not be negative.\n" << RESET;
+        return 1;
+    }
+    threads = max(1, threads);
+
+    PolicyTrainer trainer;
+    cout << BOLD << "Training on " << episodes << " self-play games with " << threads << " thread(s), seed " << seed << RESET << "\n";
+    auto start = std::chrono::steady_clock::now();
+    vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        long long share = episodes * (t + 1) / threads - episodes * t / threads;
+        workers.emplace_back([&trainer, share, seed, t]() { trainer.worker(share, seed + (uint64_t)t * 0x9E3779B97F4A7C15ULL); });
+    }
+    for (std::thread& w : workers) w.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    LearnedPolicy policy;
+    policy.assign(trainer.quantize(), (uint64_t)trainer.episodesDone.load());
+    policy.temperature[2] = mediumTemperature;
+    policy.temperature[3] = hardTemperature;
+    cout << "   Time: " << fixed << setprecision(2) << seconds << " s | " << setprecision(0) << episodes / max(seconds, 1e-9)
+         << " games/s\n";
+    cout << "   Best move keeps the perfect-play value in " << setprecision(2) << policyAccuracy(policy) << "% of positions\n";
+
+    // Every row plays the same seeded games. A level takes the policy at the
+    // first temperature (the requested one, then cooler) that reaches its
+    // strength target against both opponents; if even greedy play misses it,
+    // the level keeps its rules. The rules rows are for comparison.
+    const int games = 10000;
+    auto playRow = [&](const string& name, const LearnedPolicy* tested, double temperature, int level, double* easyWins,
+                       double* impossibleDraws) {
+        cout << left << setw(24) << name << right;
+        for (int opponent : {1, 4}) {
+            SimulationTally t = playPolicyMatch(tested, temperature, level, opponent, games, seed ^ 0xE7A1);
+            if (opponent == 1) *easyWins = 100.0 * t.xWins / games;
+            else *impossibleDraws = 100.0 * t.draws / games;
+            ostringstream cell;
+            cell << fixed << setprecision(1) << 100.0 * t.xWins / games << " / " << 100.0 * t.draws / games << " / "
+                 << 100.0 * t.oWins / games;
+            cout << left << setw(26) << cell.str() << right;
+        }
+    };
+    cout << "\n" << left << setw(24) << "player" << setw(26) << "vs Easy (W/D/L %)" << "vs Impossible (W/D/L %)\n" << right;
+    for (int level : {3, 2}) {
+        const char* name = level == 3 ? "Hard" : "Medium";
+        double easyWins, impossibleDraws;
+        cout << BOLD << name << RESET << " target: Easy wins >= " << setprecision(0) << POLICY_MIN_EASY_WINS[level]
+             << "%, Impossible draws >= " << POLICY_MIN_IMPOSSIBLE_DRAWS[level] << "%\n";
+        for (double temperature = policy.temperature[level];; temperature = temperature > 0.01 ? temperature / 2 : 0) {
+            playRow(string("  policy T=") + to_string(temperature).substr(0, 5), &policy, temperature, level, &easyWins,
+                    &impossibleDraws);
+            bool reached = easyWins >= POLICY_MIN_EASY_WINS[level] && impossibleDraws >= POLICY_MIN_IMPOSSIBLE_DRAWS[level];
+            cout << (reached ? GREEN "target" : YELLOW "missed") << RESET << "\n";
+            if (reached) {
+                policy.temperature[level] = temperature;
+                policy.levels |= 1 << level;
+                break;
+            }
+            if (temperature == 0) break;
+        }
+        playRow("  rules", nullptr, 0.0, level, &easyWins, &impossibleDraws);
+        cout << "\n";
+    }
+    cout << setprecision(2) << "\n   Medium plays the "
+         << (policy.plays(2) ? GREEN "policy (T=" + to_string(policy.temperature[2]).substr(0, 5) + ")" : YELLOW "rules") << RESET
+         << ", Hard plays the "
+         << (policy.plays(3) ? GREEN "policy (T=" + to_string(policy.temperature[3]).substr(0, 5) + ")" : YELLOW "rules") << RESET
+         << "\n";
+
+    if (!policy.save(POLICY_FILE)) {
+        cout << RED << "Could not write " << POLICY_FILE << "\n" << RESET;
+        return 1;
+    }
+    cout << "\nWrote " << POLICY_FILE << " (" << POSITION_COUNT * 9 / 1024 << " KB); it takes effect from the next run on.\n";
+    return 0;
+}
+
+#ifdef __linux__
+// ---------------------------------------------------------------------------
+// TCP game server: one epoll I/O thread owns every session and game; AI moves
+// run on a worker pool and come back through an eventfd.
+// Usage: TicTacToe --serve [port] [workers]
+//
+// Protocol, one command per line:
+//   NEW AI <level 1-4>   new game against the computer (you play X)
+//   NEW PVP              new two-player game (you play X), reply carries the id
+//   JOIN <id>            join a two-player game as O
+//   MOVE <1-9>           play a cell
+//   AIMOVE               let the computer play your move
+//   HISTORY              your last finished games, newest first
+//   METRICS              engine counters and timings as one line of JSON
+//   BOARD | STATS | QUIT
+// Replies are "OK ...", "ERR <reason>", "STATS ..." or "METRICS {...}". Every board change is
+// pushed to the players as "BOARD <id> <cells> <status>", where cells uses '.'
+// for empty and status is X_TO_MOVE, O_TO_MOVE, X_WINS, O_WINS or DRAW.
+// ---------------------------------------------------------------------------
+
+string encodeBoard(GameState state) {
+    string cells(9, '.');
+    for (int i = 0; i < 9; i++) {
+        if (cellAt(state, i) != ' ') cells[i] = cellAt(state, i);
+    }
+    return cells;
+}
+
+const char* boardStatus(GameState state) {
+    switch (outcome(state)) {
+        case OUTCOME_X_WINS: return "X_WINS";
+        case OUTCOME_O_WINS: return "O_WINS";
+        case OUTCOME_DRAW: return "DRAW";
+        default: return sideToMove(state) == 'X' ? "X_TO_MOVE" : "O_TO_MOVE";
+    }
+}
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Fixed pool of threads picking AI moves. Jobs carry a copy of everything they
+// need, so workers never touch server state; results are queued and the I/O
+// thread is woken through `wakeFd`.
+class AiWorkerPool {
+public:
+    struct Job {
+        uint64_t gameId;
+        uint32_t version; // Game version the job was computed for
+        GameState state;
+        int level;
+        GameRng rng;
+    };
+    struct Result {
+        uint64_t gameId;
+        uint32_t version;
+        int move;
+        GameRng rng;
+    };
+
+private:
+    std::mutex jobMutex, resultMutex;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;
+    vector<Result> results;
+    vector<std::thread> threads;
+    int wakeFd;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(jobMutex);
+                jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            char mover = sideToMove(job.state);
+            int move;
+            {
+                MetricTimer thinking(HIST_AI_MOVE_US);
+                move = chooseAiMove(toBitBoard(job.state), mover, mover == 'X' ? 'O' : 'X', job.level, job.rng,
+                                    &installedPolicy());
+            }
+            Metrics::add(COUNTER_AI_MOVES);
+            {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                results.push_back(Result{job.gameId, job.version, move, job.rng});
+            }
+            uint64_t one = 1;
+            if (::write(wakeFd, &one, sizeof(one)) < 0) { /* Counter is saturated, I/O thread is already awake */ }
+        }
+    }
+
+public:
+    AiWorkerPool(int count, int wakeFd) : wakeFd(wakeFd), stopping(false) {
+        for (int i = 0; i < count; i++) threads.emplace_back(&AiWorkerPool::workerLoop, this);
+    }
+
+    ~AiWorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    void submit(const Job& job) {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            jobs.push_back(job);
+        }
+        jobReady.notify_one();
+    }
+
+    vector<Result> drain() {
+        vector<Result> ready;
+        std::lock_guard<std::mutex> lock(resultMutex);
+        ready.swap(results);
+        return ready;
+    }
+};
+
+class GameServer {
+private:
+    struct Session {
+        string in, out;
+        uint64_t gameId = 0;
+        char side = ' ';
+        bool wantWrite = false;
+        bool closing = false; // Dropped at the end of the event loop iteration
+        RingBuffer<GameRecord> history{SESSION_HISTORY_CAPACITY};
+    };
+    struct ServerGame {
+        GameState state;
+        bool vsAi;
+        int level;
+        int fdX, fdO;
+        uint32_t version;
+        bool aiPending;
+        GameRng rng;
+        GameRecord record; // Filled in as the game is played
+    };
+    static const size_t SESSION_HISTORY_CAPACITY = 16;
+    static const size_t MAX_PENDING_OUTPUT = 1 << 20; // A client this far behind is not reading
+    struct ServerStats {
+        long long sessions = 0, gamesStarted = 0, moves = 0, aiMoves = 0;
+        long long xWins = 0, oWins = 0, draws = 0;
+    };
+
+    int listenFd, epollFd, wakeFd;
+    std::unordered_map<int, Session> sessions;
+    std::unordered_map<uint64_t, ServerGame> games;
+    uint64_t nextGameId;
+    GameRng seedSource;
+    ServerStats stats;
+    std::unique_ptr<AiWorkerPool> pool;
+    vector<int> closingFds;
+
+    void updateInterest(int fd, Session& session) {
+        bool want = !session.out.empty();
+        if (want == session.wantWrite) return;
+        epoll_event ev{};
+        ev.events = EPOLLIN | (want ? (uint32_t)EPOLLOUT : 0u);
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+        session.wantWrite = want;
+    }
+
+    // Sessions are closed by reapSessions, never from inside a send, so callers
+    // holding a Session& stay valid
+    void markClosing(int fd, Session& session) {
+        if (session.closing) return;
+        session.closing = true;
+        session.out.clear();
+        closingFds.push_back(fd);
+    }
+
+    void flush(int fd, Session& session) {
+        while (!session.out.empty() && !session.closing) {
+            ssize_t n = ::send(fd, session.out.data(), session.out.size(), MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                markClosing(fd, session); // Peer reset or similar
+                return;
+            }
+            if (n <= 0) break;
+            session.out.erase(0, (size_t)n);
+        }
+        updateInterest(fd, session);
+    }
+
+    void reply(int fd, const string& line) {
+        auto it = sessions.find(fd);
+        if (it == sessions.end() || it->second.closing) return;
+        it->second.out += line;
+        it->second.out += '\n';
+        if (it->second.out.size() > MAX_PENDING_OUTPUT) {
+            markClosing(fd, it->second);
+            return;
+        }
+        flush(fd, it->second);
+    }
+
+    void pushBoard(uint64_t id, const ServerGame& game) {
+        string line = "BOARD " + to_string(id) + " " + encodeBoard(game.state) + " " + boardStatus(game.state);
+        if (game.fdX >= 0) reply(game.fdX, line);
+        if (game.fdO >= 0) reply(game.fdO, line);
+    }
+
+    // Applies a validated move; returns true if it ended the game
+    bool applyMove(uint64_t id, ServerGame& game, int cell) {
+        game.state = ::applyMove(game.state, cell);
+        game.record.addMove(cell);
+        game.version++;
+        stats.moves++;
+        pushBoard(id, game);
+        GameOutcome result = outcome(game.state);
+        if (result == OUTCOME_X_WINS) stats.xWins++;
+        else if (result == OUTCOME_O_WINS) stats.oWins++;
+        else if (result == OUTCOME_DRAW) stats.draws++;
+        else return false;
+        game.record.result = result == OUTCOME_X_WINS ? RESULT_X_WINS : (result == OUTCOME_O_WINS ? RESULT_O_WINS : RESULT_TIE);
+        for (int fd : {game.fdX, game.fdO}) {
+            auto it = sessions.find(fd);
+            if (fd >= 0 && it != sessions.end()) it->second.history.push(game.record);
+        }
+        return true;
+    }
+
+    void dispatchAi(uint64_t id, ServerGame& game) {
+        game.aiPending = true;
+        pool->submit(AiWorkerPool::Job{id, game.version, game.state, game.level, game.rng});
+    }
+
+    void leaveGame(int fd, Session& session) {
+        auto it = games.find(session.gameId);
+        session.gameId = 0;
+        if (it == games.end()) return;
+        ServerGame& game = it->second;
+        if (game.fdX == fd) game.fdX = -1;
+        if (game.fdO == fd) game.fdO = -1;
+        if (game.fdX < 0 && game.fdO < 0) {
+            games.erase(it);
+        } else {
+            int other = game.fdX >= 0 ? game.fdX : game.fdO;
+            reply(other, "ERR opponent left");
+        }
+    }
+
+    void closeSession(int fd) {
+        auto it = sessions.find(fd);
+        if (it == sessions.end()) return;
+        leaveGame(fd, it->second);
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        sessions.erase(fd);
+    }
+
+    void reapSessions() {
+        while (!closingFds.empty()) { // Closing one can push "opponent left" over another's cap
+            int fd = closingFds.back();
+            closingFds.pop_back();
+            closeSession(fd);
+        }
+    }
+
+    // Returns false when the session should be closed
+    bool handleCommand(int fd, const string& line) {
+        Session& session = sessions[fd];
+        istringstream in(line);
+        string command;
+        in >> command;
+        for (char& c : command) c = (char)toupper((unsigned char)c);
+
+        if (command == "NEW") {
+            string mode;
+            int level = 4;
+            in >> mode;
+            for (char& c : mode) c = (char)toupper((unsigned char)c);
+            if (mode == "AI") {
+                if (!(in >> level) || level < 1 || level > 4) {
+                    reply(fd, "ERR level must be 1-4");
+                    return true;
+                }
+            } else if (mode != "PVP") {
+                reply(fd, "ERR usage: NEW AI <level> | NEW PVP");
+                return true;
+            }
+            leaveGame(fd, session);
+            uint64_t id = nextGameId++;
+            uint64_t seed = seedSource.next64();
+            GameRecord record = {};
+            record.timestamp = (int64_t)time(0);
+            record.seed = seed;
+            record.mode = (mode == "AI") ? MODE_VS_COMPUTER : MODE_MULTIPLAYER;
+            record.level = (uint8_t)(mode == "AI" ? level : 0);
+            record.setPlayers("client " + to_string(fd), mode == "AI" ? "Computer" : "(waiting)");
+            games[id] = ServerGame{EMPTY_STATE, mode == "AI", level, fd, -1, 0, false, GameRng(seed), record};
+            session.gameId = id;
+            session.side = 'X';
+            stats.gamesStarted++;
+            reply(fd, "OK " + to_string(id));
+            pushBoard(id, games[id]);
+        } else if (command == "JOIN") {
+            uint64_t id = 0;
+            in >> id;
+            auto it = games.find(id);
+            if (it == games.end() || it->second.vsAi || it->second.fdO >= 0) {
+                reply(fd, "ERR no open game with that id");
+                return true;
+            }
+            leaveGame(fd, session);
+            it->second.fdO = fd;
+            snprintf(it->second.record.playerO, sizeof(it->second.record.playerO), "client %d", fd);
+            session.gameId = id;
+            session.side = 'O';
+            reply(fd, "OK " + to_string(id));
+            pushBoard(id, it->second);
+        } else if (command == "MOVE" || command == "AIMOVE") {
+            auto it = games.find(session.gameId);
+            if (it == games.end()) {
+                reply(fd, "ERR no game, send NEW first");
+                return true;
+            }
+            ServerGame& game = it->second;
+            if (outcome(game.state) != OUTCOME_ONGOING) {
+                reply(fd, "ERR game is over");
+                return true;
+            }
+            if (game.aiPending || sideToMove(game.state) != session.side) {
+                reply(fd, "ERR not your turn");
+                return true;
+            }
+            if (!game.vsAi && game.fdO < 0) {
+                reply(fd, "ERR waiting for an opponent");
+                return true;
+            }
+            if (command == "AIMOVE") {
+                dispatchAi(session.gameId, game);
+                return true;
+            }
+            int cell = 0;
+            if (!(in >> cell) || !isLegalMove(game.state, cell - 1)) {
+                reply(fd, "ERR invalid cell");
+                return true;
+            }
+            if (!applyMove(session.gameId, game, cell - 1) && game.vsAi) dispatchAi(session.gameId, game);
+        } else if (command == "BOARD") {
+            auto it = games.find(session.gameId);
+            if (it == games.end()) reply(fd, "ERR no game, send NEW first");
+            else pushBoard(session.gameId, it->second);
+        } else if (command == "STATS") {
+            reply(fd, "STATS sessions=" + to_string(sessions.size()) + " total_sessions=" + to_string(stats.sessions) +
+                      " games=" + to_string(stats.gamesStarted) + " active_games=" + to_string(games.size()) +
+                      " moves=" + to_string(stats.moves) + " ai_moves=" + to_string(stats.aiMoves) +
+                      " x_wins=" + to_string(stats.xWins) + " o_wins=" + to_string(stats.oWins) +
+                      " draws=" + to_string(stats.draws));
+        } else if (command == "METRICS") {
+            reply(fd, "METRICS " + metricsJson(Metrics::global().snapshot()));
+        } else if (command == "HISTORY") {
+            // Records stay packed until someone asks for them
+            reply(fd, "OK " + to_string(session.history.size()));
+            for (size_t i = 0; i < session.history.size(); i++) {
+                reply(fd, "GAME " + describeGameRecord(session.history.newest(i)));
+            }
+        } else if (command == "QUIT") {
+            reply(fd, "OK bye");
+            return false;
+        } else if (!command.empty()) {
+            reply(fd, "ERR unknown command");
+        }
+        return true;
+    }
+
+    void onReadable(int fd) {
+        char buffer[4096];
+        while (true) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                Session& session = sessions[fd];
+                session.in.append(buffer, (size_t)n);
+                if (session.in.size() > 65536) { // Nobody sends lines this long
+                    markClosing(fd, session);
+                    return;
+                }
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                markClosing(fd, sessions[fd]);
+                return;
+            }
+            break;
+        }
+        size_t start = 0, end;
+        while (sessions.count(fd) && !sessions[fd].closing && (end = sessions[fd].in.find('\n', start)) != string::npos) {
+            string line = sessions[fd].in.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            start = end + 1;
+            if (!handleCommand(fd, line)) {
+                markClosing(fd, sessions[fd]);
+                return;
+            }
+        }
+        if (sessions.count(fd)) sessions[fd].in.erase(0, start);
+    }
+
+    void onAiResults() {
+        uint64_t count;
+        if (::read(wakeFd, &count, sizeof(count)) < 0) { /* Spurious wake-up */ }
+        for (const AiWorkerPool::Result& result : pool->drain()) {
+            auto it = games.find(result.gameId);
+            if (it == games.end() || it->second.version != result.version) continue; // Game moved on or is gone
+            ServerGame& game = it->second;
+            game.aiPending = false;
+            game.rng = result.rng;
+            stats.aiMoves++;
+            // A delegated AIMOVE played X's move in a vs-AI game: the computer still owes its reply
+            if (!applyMove(result.gameId, game, result.move) && game.vsAi && sideToMove(game.state) == 'O') {
+                dispatchAi(result.gameId, game);
+            }
+        }
+    }
+
+public:
+    GameServer() : listenFd(-1), epollFd(-1), wakeFd(-1), nextGameId(1), seedSource((uint64_t)time(0)) {}
+
+    ~GameServer() {
+        pool.reset();
+        for (auto& entry : sessions) ::close(entry.first);
+        if (listenFd >= 0) ::close(listenFd);
+        if (wakeFd >= 0) ::close(wakeFd);
+        if (epollFd >= 0) ::close(epollFd);
+    }
+
+    int run(int port, int workers) {
+        listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int yes = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons((uint16_t)port);
+        if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listenFd, 1024) < 0 ||
+            !setNonBlocking(listenFd)) {
+            cout << RED << "Cannot listen on port " << port << "\n" << RESET;
+            return 1;
+        }
+        epollFd = epoll_create1(0);
+        wakeFd = eventfd(0, EFD_NONBLOCK);
+        pool.reset(new AiWorkerPool(workers, wakeFd));
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = listenFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+        ev.data.fd = wakeFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+        cout << BOLD << "Tic Tac Toe server listening on port " << port << " with " << workers << " AI worker(s)\n" << RESET;
+
+        epoll_event events[256];
+        while (true) {
+            int ready = epoll_wait(epollFd, events, 256, -1);
+            if (ready < 0 && errno != EINTR) break;
+            for (int e = 0; e < ready; e++) {
+                int fd = events[e].data.fd;
+                if (fd == listenFd) {
+                    int client;
+                    while ((client = ::accept(listenFd, nullptr, nullptr)) >= 0) {
+                        setNonBlocking(client);
+                        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                        epoll_event cev{};
+                        cev.events = EPOLLIN;
+                        cev.data.fd = client;
+                        epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &cev);
+                        sessions[client] = Session();
+                        stats.sessions++;
+                    }
+                } else if (fd == wakeFd) {
+                    onAiResults();
+                } else {
+                    auto it = sessions.find(fd);
+                    if (it == sessions.end() || it->second.closing) continue;
+                    if (events[e].events & (EPOLLERR | EPOLLHUP)) {
+                        markClosing(fd, it->second);
+                        continue;
+                    }
+                    if (events[e].events & EPOLLOUT) flush(fd, it->second);
+                    if (events[e].events & EPOLLIN) onReadable(fd);
+                }
+            }
+            reapSessions();
+        }
+        return 0;
+    }
+};
+
+int runServer(int argc, char* argv[]) {
+    int port = (argc > 2) ? atoi(argv[2]) : 7777;
+    int workers = (argc > 3) ? atoi(argv[3]) : max(1, (int)std::thread::hardware_concurrency());
+    GameServer server;
+    return server.run(port, max(1, workers));
+}
+
+// ---------------------------------------------------------------------------
+// Load generator for the server: every connection plays random moves against
+// the computer and times each MOVE until the computer's reply arrives. Every
+// other game opens with AIMOVE instead; a game that stalls fails the run.
+// Usage: TicTacToe --loadgen [host] [port] [connections] [games per connection] [level]
+// ---------------------------------------------------------------------------
+
+int runLoadGenerator(int argc, char* argv[]) {
+    string host = (argc > 2) ? argv[2] : "127.0.0.1";
+    int port = (argc > 3) ? atoi(argv[3]) : 7777;
+    int connections = (argc > 4) ? atoi(argv[4]) : 100;
+    int gamesEach = (argc > 5) ? atoi(argv[5]) : 10;
+    int level = (argc > 6) ? atoi(argv[6]) : 4;
+    typedef std::chrono::steady_clock Clock;
+
+    struct Client {
+        int fd;
+        string in;
+        int gamesLeft;
+        bool waiting;
+        Clock::time_point sentAt;
+        GameRng rng;
+    };
+    std::unordered_map<int, Client> clients;
+    vector<double> latenciesUs;
+    int epollFd = epoll_create1(0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        cout << RED << "Invalid IPv4 address: " << host << "\n" << RESET;
+        return 1;
+    }
+
+    auto sendLine = [](int fd, const string& line) {
+        string data = line + "\n";
+        return ::send(fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t)data.size();
+    };
+
+    Clock::time_point start = Clock::now();
+    for (int c = 0; c < connections; c++) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            cout << RED << "Connection " << c << " failed: " << strerror(errno) << "\n" << RESET;
+            if (fd >= 0) ::close(fd);
+            break;
+        }
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        setNonBlocking(fd);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        clients[fd] = Client{fd, "", gamesEach, false, Clock::now(), GameRng((uint64_t)c)};
+        sendLine(fd, "NEW AI " + to_string(level));
+    }
+
+    long long gamesDone = 0, delegatedOpenings = 0;
+    bool timedOut = false; // A stuck game (e.g. the computer never replying) shows up here
+    epoll_event events[256];
+    while (!clients.empty()) {
+        int ready = epoll_wait(epollFd, events, 256, 5000);
+        if (ready <= 0) {
+            cout << RED << "Timed out waiting for the server\n" << RESET;
+            timedOut = true;
+            break;
+        }
+        for (int e = 0; e < ready; e++) {
+            int fd = events[e].data.fd;
+            auto it = clients.find(fd);
+            if (it == clients.end()) continue;
+            Client& client = it->second;
+            char buffer[4096];
+            ssize_t n;
+            while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) client.in.append(buffer, (size_t)n);
+            bool closed = (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK));
+
+            size_t pos;
+            while (!closed && (pos = client.in.find('\n')) != string::npos) {
+                string line = client.in.substr(0, pos);
+                client.in.erase(0, pos + 1);
+                if (line.compare(0, 6, "BOARD ") != 0) continue;
+                istringstream fields(line.substr(6));
+                string id, cells, status;
+                fields >> id >> cells >> status;
+                if (status == "O_TO_MOVE") continue; // Our move was accepted, computer to reply
+                if (client.waiting) {
+                    latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - client.sentAt).count());
+                    client.waiting = false;
+                }
+                if (status == "X_TO_MOVE") {
+                    int empty[9], count = 0;
+                    for (int i = 0; i < 9; i++) {
+                        if (cells[i] == '.') empty[count++] = i;
+                    }
+                    if (count == 9 && client.gamesLeft % 2 == 0) {
+                        // Every other game delegates its opening: the server must
+                        // play X's move and then still reply as the computer
+                        sendLine(fd, "AIMOVE");
+                        delegatedOpenings++;
+                        continue;
+                    }
+                    client.sentAt = Clock::now();
+                    client.waiting = true;
+                    sendLine(fd, "MOVE " + to_string(empty[client.rng.below(count)] + 1));
+                } else {
+                    gamesDone++;
+                    if (--client.gamesLeft > 0) sendLine(fd, "NEW AI " + to_string(level));
+                    else closed = true;
+                }
+            }
+            if (closed) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                ::close(fd);
+                clients.erase(it);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ::close(epollFd);
+
+    if (latenciesUs.empty()) {
+        cout << RED << "No moves completed.\n" << RESET;
+        return 1;
+    }
+    sort(latenciesUs.begin(), latenciesUs.end());
+    auto percentile = [&](double p) { return latenciesUs[min(latenciesUs.size() - 1, (size_t)(p * latenciesUs.size()))]; };
+    cout << BOLD << connections << " connection(s), " << gamesDone << " games, " << latenciesUs.size() << " moves in "
+         << fixed << setprecision(2) << seconds << " s" << RESET << "\n";
+    cout << "   Move latency p50: " << percentile(0.50) << " us | p99: " << percentile(0.99)
+         << " us | max: " << latenciesUs.back() << " us\n";
+    cout << "   Throughput: " << setprecision(0) << latenciesUs.size() / seconds << " moves/s\n";
+    cout << "   Openings delegated with AIMOVE: " << delegatedOpenings << "\n";
+    return timedOut ? 1 : 0;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Scripted input driver: runs the real interactive game in a child process on
+// a pseudo-terminal, types a keystroke script into it and times every turn
+// from the keystrokes to the game waiting for input again (frame rendered,
+// AI move made). Cosmetic sleeps and typing effects are skipped in the child.
+// Usage: TicTacToe --drive [script] [runs]
+//
+// Script: one answer per prompt. A line is typed and followed by Enter; a
+// line starting with '!' types the key after it without Enter ("!" alone
+// types a space), for "press any key" prompts. '#' starts a comment line.
+// ---------------------------------------------------------------------------
+
+#ifndef _WIN32
+const char* const DEFAULT_DRIVE_SCRIPT =
+    "# VS Computer, Impossible (a draw)\n1\nDriver\n4\n5\n2\n9\n4\n7\nn\n"
+    "# Multiplayer: X wins on the diagonal\n2\nAnn\nBen\n1\n2\n5\n3\n9\nn\n"
+    "# Statistics, history, engine stats, exit\n3\n!\n5\n!q\n8\n!q\n9\n";
+
+struct DriveTurn {
+    string keys;
+    string label; // As written in the script, for the report
+};
+
+vector<DriveTurn> parseDriveScript(istream& in) {
+    vector<DriveTurn> turns;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line[0] == '#') continue;
+        if (!line.empty() && line[0] == '!') turns.push_back({line.size() > 1 ? line.substr(1, 1) : string(" "), line});
+        else turns.push_back({line + "\r", line});
+    }
+    return turns;
+}
+
+// Reads the child's output until it next waits for input; false if it exited
+// or stayed silent past the timeout
+bool waitForInputPrompt(int master, string& tail, int timeoutMs) {
+    const string marker = TerminalInput::INPUT_MARKER;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    char buffer[4096];
+    while (true) {
+        size_t found = tail.find(marker);
+        if (found != string::npos) {
+            tail.erase(0, found + marker.size());
+            return true;
+        }
+        if (tail.size() >= marker.size()) tail.erase(0, tail.size() - (marker.size() - 1)); // Keep a partial marker only
+        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) return false;
+        struct pollfd out = {master, POLLIN, 0};
+        int ready = poll(&out, 1, left);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) return false;
+        ssize_t n = read(master, buffer, sizeof(buffer));
+        if (n <= 0) return false; // EIO: the child closed the terminal
+        tail.append(buffer, (size_t)n);
+    }
+}
+
+// One session; fills per-turn latencies (ms) and returns the session time, or -1 on failure
+double driveSession(const string& executable, const string& workDir, const vector<DriveTurn>& turns, vector<double>& latencies,
+                    size_t& failedTurn) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pseudo-terminal");
+        if (master >= 0) ::close(master);
+        return -1;
+    }
+    string slaveName = ptsname(master);
+    struct winsize size = {40, 100, 0, 0};
+    ioctl(master, TIOCSWINSZ, &size);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child == 0) {
+        setsid();
+        int slave = open(slaveName.c_str(), O_RDWR); // Becomes the controlling terminal
+        if (slave < 0) _exit(127);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        if (slave > STDERR_FILENO) ::close(slave);
+        ::close(master);
+        if (chdir(workDir.c_str()) != 0) _exit(127);
+        setenv("TICTACTOE_DRIVEN", "1", 1);
+        execl(executable.c_str(), executable.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+
+    string tail;
+    failedTurn = turns.size();
+    bool alive = waitForInputPrompt(master, tail, 30000);
+    for (size_t t = 0; t < turns.size() && alive; t++) {
+        auto sent = std::chrono::steady_clock::now();
+        if (write(master, turns[t].keys.data(), turns[t].keys.size()) != (ssize_t)turns[t].keys.size()) break;
+        // The last answer usually ends the game, so only the others must bring a new prompt
+        alive = waitForInputPrompt(master, tail, 30000);
+        if (!alive && t + 1 < turns.size()) {
+            failedTurn = t;
+            break;
+        }
+        latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count());
+    }
+    ::close(master); // Hangs up the child if the script left it waiting
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (failedTurn < turns.size()) return -1;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int runInputDriver(int argc, char* argv[]) {
+    string scriptPath = (argc > 2) ? argv[2] : "";
+    int runs = (argc > 3) ? max(1, atoi(argv[3])) : 5;
+    vector<DriveTurn> turns;
+    if (scriptPath.empty() || scriptPath == "-") {
+        istringstream script(DEFAULT_DRIVE_SCRIPT);
+        turns = parseDriveScript(script);
+        scriptPath = "built-in";
+    } else {
+        ifstream script(scriptPath);
+        if (!script) {
+            cout << RED << "Cannot read " << scriptPath << "\n" << RESET;
+            return 1;
+        }
+        turns = parseDriveScript(script);
+    }
+    if (turns.empty()) {
+        cout << RED << "Script has no turns.\n" << RESET;
+        return 1;
+    }
+
+    // argv[0] stops resolving once the child changes directory
+    char resolved[PATH_MAX];
+    string executable = realpath(argv[0], resolved) ? resolved : argv[0];
+    // A scratch directory keeps driven games out of the player's log and ratings
+    char scratch[] = "/tmp/tictactoe-drive-XXXXXX";
+    if (!mkdtemp(scratch)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    cout << BOLD << "Driving " << runs << " session(s) of the " << scriptPath << " script (" << turns.size() << " turns)\n" << RESET;
+    vector<double> latencies, sessions;
+    vector<double> perTurnTotal(turns.size(), 0.0);
+    for (int run = 0; run < runs; run++) {
+        vector<double> runLatencies;
+        size_t failedTurn = 0;
+        double sessionMs = driveSession(executable, scratch, turns, runLatencies, failedTurn);
+        unlink((string(scratch) + "/" + GAME_LOG_FILE).c_str()); // Every run starts from an empty log
+        if (sessionMs < 0) {
+            cout << RED << "Run " << (run + 1) << ": no prompt after turn " << (failedTurn + 1) << " (\""
+                 << turns[min(failedTurn, turns.size() - 1)].label << "\"); the script is out of step with the game\n" << RESET;
+            rmdir(scratch);
+            return 1;
+        }
+        for (size_t t = 0; t < runLatencies.size(); t++) perTurnTotal[t] += runLatencies[t];
+        latencies.insert(latencies.end(), runLatencies.begin(), runLatencies.end());
+        sessions.push_back(sessionMs);
+    }
+    rmdir(scratch);
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+    double sessionTotal = 0;
+    for (double ms : sessions) sessionTotal += ms;
+    cout << fixed << setprecision(2);
+    cout << "   Turn latency (keys -> next prompt) p50: " << percentile(0.50) << " ms | p90: " << percentile(0.90)
+         << " ms | p99: " << percentile(0.99) << " ms | max: " << latencies.back() << " ms\n";
+    cout << "   Session time avg: " << sessionTotal / sessions.size() << " ms | min: "
+         << *min_element(sessions.begin(), sessions.end()) << " ms | max: " << *max_element(sessions.begin(), sessions.end()) << " ms\n";
+
+    vector<size_t> order(turns.size());
+    for (size_t t = 0; t < order.size(); t++) order[t] = t;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return perTurnTotal[a] > perTurnTotal[b]; });
+    cout << "   Slowest turns (avg):\n";
+    for (size_t i = 0; i < min<size_t>(5, order.size()); i++) {
+        cout << "     #" << setw(3) << left << (order[i] + 1) << right << setw(10) << perTurnTotal[order[i]] / runs << " ms  \""
+             << turns[order[i]].label << "\"\n";
+    }
+    return 0;
+}
+#endif
+
+int runReplay(int argc, char* argv[]) {
+    if (argc < 5) {
+        cout << "Usage: " << argv[0] << " --replay <X level 1-4> <O level 1-4> <game seed>\n";
+        return 1;
+    }
+    int levelX = atoi(argv[2]), levelO = atoi(argv[3]);
+    if (levelX < 1 || levelX > 4 || levelO < 1 || levelO > 4) {
+        cout << RED << "Levels must be 1-4.\n" << RESET;
+        return 1;
+    }
+    int moves[9] = {-1, -1, -1, -1, -1, -1, -1, -1, -1};
+    char winner = playHeadlessGame(levelX, levelO, strtoull(argv[4], nullptr, 10), moves);
+    cout << "Moves:";
+    for (int ply = 0; ply < 9 && moves[ply] >= 0; ply++) {
+        cout << " " << (ply % 2 == 0 ? 'X' : 'O') << (moves[ply] + 1);
+    }
+    cout << "\nResult: " << (winner == ' ' ? string("draw") : string(1, winner) + " wins") << "\n";
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Perft: counts every move sequence (and finished game) up to a depth, for
+// 3x3 (BitBoard) and the N x N GridBoards. Subtrees below the first two plies
+// are shared out to threads. Full 3x3 counts are checked against the known
+// totals, so this doubles as a regression test.
+// Usage: TicTacToe --perft [3|4|5] [depth] [threads]
+// ---------------------------------------------------------------------------
+
+struct PerftCounts {
+    vector<long long> nodes; // nodes[d]: positions reached after d plies
+    long long xWins = 0, oWins = 0, draws = 0; // Games finished within the depth
+
+    explicit PerftCounts(int depth = 0) : nodes(depth + 1, 0) {}
+
+    void add(const PerftCounts& other) {
+        for (size_t d = 0; d < nodes.size(); d++) nodes[d] += other.nodes[d];
+        xWins += other.xWins;
+        oWins += other.oWins;
+        draws += other.draws;
+    }
+};
+
+template <typename Board>
+void perft(Board& board, char mover, int ply, int depth, PerftCounts& counts) {
+    char other = (mover == 'X' ? 'O' : 'X');
+    for (int i = 0; i < Board::CELLS; i++) {
+        if (!board.isEmpty(i)) continue;
+        board.place(i, mover);
+        counts.nodes[ply + 1]++;
+        if (board.winsAt(i, mover)) (mover == 'X' ? counts.xWins : counts.oWins)++;
+        else if (board.isFull()) counts.draws++;
+        else if (ply + 1 < depth) perft(board, other, ply + 1, depth, counts);
+        board.remove(i);
+    }
+}
+
+template <typename Board>
+PerftCounts parallelPerft(int depth, int threadCount) {
+    // Work items are the positions after two plies; shallower plies are counted here
+    PerftCounts counts(depth);
+    counts.nodes[0] = 1;
+    vector<pair<int, int>> tasks;
+    for (int a = 0; a < Board::CELLS && depth >= 1; a++) {
+        counts.nodes[1]++;
+        for (int b = 0; b < Board::CELLS && depth >= 2; b++) {
+            if (b == a) continue;
+            counts.nodes[2]++;
+            tasks.push_back(make_pair(a, b));
         }
-        cout << "\n";
     }
 
-    void showDefeatMessage() {
-        cout << BOLD << RED << "    (>_<)   OH NO! YOU LOST!   (>_<)\n" << RESET;
-        cout << BOLD << WHITE << "  Better luck next time!\n" << RESET;
-        // Simple animation
-        for (int i = 0; i < 3; ++i) {
-            cout << RED << "  (x_x) " << RESET << flush;
-            customSleep(200);
-            cout << "\r" << "        " << flush; // Clear line
-            cout << WHITE << "  (o_o) " << RESET << flush;
-            customSleep(200);
-            cout << "\r" << "        " << flush; // Clear line
+    std::atomic<size_t> nextTask(0);
+    vector<PerftCounts> partial(threadCount, PerftCounts(depth));
+    auto work = [&](PerftCounts& mine) {
+        Board board;
+        for (size_t t = nextTask++; t < tasks.size(); t = nextTask++) {
+            board.place(tasks[t].first, 'X');
+            board.place(tasks[t].second, 'O');
+            if (depth > 2) perft(board, 'X', 2, depth, mine);
+            board.remove(tasks[t].second);
+            board.remove(tasks[t].first);
         }
-        cout << "\n";
+    };
+    vector<std::thread> helpers;
+    for (int t = 1; t < threadCount; t++) helpers.emplace_back(work, std::ref(partial[t]));
+    work(partial[0]);
+    for (std::thread& helper : helpers) helper.join();
+    for (const PerftCounts& p : partial) counts.add(p);
+    return counts;
+}
+
+int runPerft(int argc, char* argv[]) {
+    int size = argc > 2 ? atoi(argv[2]) : 3;
+    int threadCount = argc > 4 ? max(1, atoi(argv[4])) : max(1, (int)std::thread::hardware_concurrency());
+    int cells = size * size;
+    if (size != 3 && size != 4 && size != 5) {
+        cout << "Usage: " << argv[0] << " --perft [3|4|5] [depth] [threads]\n";
+        return 1;
     }
-    
-    void updateGameHistory(string result) {
-        time_t now = time(0);
-        char* timeStr = ctime(&now);
-        string timestamp(timeStr);
-        timestamp.pop_back(); // Remove newline
-        gameHistory.push_back(timestamp + " - " + result);
-        if (gameHistory.size() > 10) { // Keep only last 10 games
-            gameHistory.erase(gameHistory.begin());
+    int depth = argc > 3 ? min(max(2, atoi(argv[3])), cells) : (size == 3 ? 9 : 6);
+
+    auto start = std::chrono::steady_clock::now();
+    PerftCounts counts = size == 3 ? parallelPerft<BitBoard>(depth, threadCount)
+                       : size == 4 ? parallelPerft<GridBoard<4, 4>>(depth, threadCount)
+                                   : parallelPerft<GridBoard<5, 4>>(depth, threadCount);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long long totalNodes = 0;
+    cout << "Perft " << size << "x" << size << ", depth " << depth << ", " << threadCount << " threads\n";
+    cout << right << setw(6) << "depth" << setw(16) << "nodes" << "\n";
+    for (int d = 1; d <= depth; d++) {
+        cout << setw(6) << d << setw(16) << counts.nodes[d] << "\n";
+        totalNodes += counts.nodes[d];
+    }
+    cout << "Games finished: " << (counts.xWins + counts.oWins + counts.draws) << " (X " << counts.xWins
+         << ", O " << counts.oWins << ", draws " << counts.draws << ")\n";
+    cout << "Total nodes: " << totalNodes << " in " << fixed << setprecision(3) << seconds << " s ("
+         << setprecision(0) << totalNodes / max(seconds, 1e-9) << " nodes/s)\n";
+
+    if (size == 3 && depth == 9) {
+        static const long long expectedNodes[10] = {1, 9, 72, 504, 3024, 15120, 54720, 148176, 200448, 127872};
+        bool ok = counts.xWins == 131184 && counts.oWins == 77904 && counts.draws == 46080;
+        for (int d = 0; d <= 9; d++) ok = ok && counts.nodes[d] == expectedNodes[d];
+        cout << (ok ? GREEN "PASS" : RED "FAIL") << RESET << ": expected 255168 games (X 131184, O 77904, draws 46080)\n";
+        return ok ? 0 : 1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Batch game analysis over a game-record file
+// Usage: TicTacToe --analyze [file] [threads]
+// The file is mapped read-only and split into fixed chunks that threads take
+// in turn, so memory stays flat however large the log is. Every 3x3 move is
+// judged against the perfect-play table (the same values minimaxMove finds):
+//   best        - keeps the best achievable score
+//   inaccuracy  - keeps the result but wins slower / loses faster
+//   blunder     - throws away a win or a draw
+// ---------------------------------------------------------------------------
+
+enum MoveGrade { GRADE_BEST, GRADE_INACCURACY, GRADE_BLUNDER };
+
+inline MoveGrade gradeMove(int idx, int cell, bool xToMove) {
+    int best = PERFECT_PLAY.score(idx);
+    int score = -PERFECT_PLAY.score(idx + (xToMove ? 1 : 2) * TERNARY.weight[1u << cell]);
+    score -= (score > 0) - (score < 0); // One ply further from the result, as in the table
+    if (score >= best) return GRADE_BEST;
+    int bestValue = (best > 0) - (best < 0), value = (score > 0) - (score < 0);
+    return value < bestValue ? GRADE_BLUNDER : GRADE_INACCURACY;
+}
+
+struct AnalysisTally {
+    long long moves = 0;
+    long long grades[3] = {0, 0, 0};
+
+    void add(const AnalysisTally& other) {
+        moves += other.moves;
+        for (int g = 0; g < 3; g++) grades[g] += other.grades[g];
+    }
+
+    double accuracy() const { return moves > 0 ? 100.0 * grades[GRADE_BEST] / moves : 0.0; }
+};
+
+struct alignas(64) AnalysisWorker {
+    AnalysisTally total;
+    long long games = 0, skipped = 0;
+    std::unordered_map<string, AnalysisTally> byPlayer;
+};
+
+// Writes the stone masks after each ply of a record to xs/os and returns the
+// ply count, or 0 if it is not a 3x3 game or plays onto a taken cell. Whether
+// the game ended early is left to the batch classifier.
+int replayRecord(const GameRecord& record, uint16_t* xs, uint16_t* os) {
+    if ((record.mode != MODE_VS_COMPUTER && record.mode != MODE_MULTIPLAYER) || record.moveCount == 0 ||
+        record.moveCount > 9) {
+        return 0;
+    }
+    GameState state = EMPTY_STATE;
+    for (int ply = 0; ply < record.moveCount; ply++) {
+        int cell = record.moveAt(ply);
+        if (cell > 8 || cellAt(state, cell) != ' ') return 0;
+        state = applyMove(state, cell);
+        xs[ply] = state.x;
+        os[ply] = state.o;
+    }
+    return record.moveCount;
+}
+
+// Grades every move of a replayed record; `xs`/`os` are its positions after each ply
+void gradeRecord(const GameRecord& record, const uint16_t* xs, const uint16_t* os, AnalysisWorker& worker) {
+    AnalysisTally* side[2];
+    for (int s = 0; s < 2; s++) { // Tagged so a person named like a computer level is not merged with it
+        char mover = s == 0 ? 'X' : 'O';
+        side[s] = &worker.byPlayer[ratedPlayerName(record, mover) + (isComputerSide(record, mover) ? " [AI]" : "")];
+    }
+    for (int ply = 0; ply < record.moveCount; ply++) {
+        int idx = ply == 0 ? 0 : positionIndex(xs[ply - 1], os[ply - 1]);
+        MoveGrade grade = gradeMove(idx, record.moveAt(ply), ply % 2 == 0);
+        for (AnalysisTally* t : {side[ply % 2], &worker.total}) {
+            t->moves++;
+            t->grades[grade]++;
         }
     }
-    
-    void showStatistics() {
-        clearScreen();
-        printHeader();
-        cout << BOLD << YELLOW << "*** GAME STATISTICS ***\n\n" << RESET;
-        
-        cout << BOLD << CYAN << "----------------------------------------\n" << RESET;
-        cout << BOLD << WHITE << "          PLAYER STATISTICS            \n" << RESET;
-        cout << BOLD << CYAN << "----------------------------------------\n" << RESET;
-        
-        if (player1Stats.totalGames > 0) {
-            cout << BOLD << "Player: " << GREEN << player1Stats.name << RESET << "\n";
-            cout << "   Wins: " << player1Stats.wins << " | Losses: " << player1Stats.losses;
-            cout << " | Ties: " << player1Stats.ties << "\n";
-            cout << "   Win Rate: " << fixed << setprecision(1) << player1Stats.winRate << "%\n\n";
-        } else {
-            cout << "Player 1: No games played yet.\n\n";
+}
+
+// Analyzes records [begin, end): replays them, classifies every intermediate
+// position of the whole range in one classifyPositions call, and grades the
+// records that are legal games (none of them over before its last move)
+void analyzeRecords(const GameLog& log, uint64_t begin, uint64_t end, AnalysisWorker& worker, vector<uint16_t>& xs,
+                    vector<uint16_t>& os, vector<uint8_t>& classes) {
+    size_t capacity = (size_t)(end - begin) * 9;
+    xs.resize(capacity);
+    os.resize(capacity);
+    classes.resize(capacity);
+    vector<pair<uint32_t, uint8_t>> spans((size_t)(end - begin)); // Offset and ply count per record
+    size_t used = 0;
+    for (uint64_t i = begin; i < end; i++) {
+        int plies = replayRecord(log.at(i), xs.data() + used, os.data() + used);
+        spans[i - begin] = make_pair((uint32_t)used, (uint8_t)plies);
+        used += (size_t)plies;
+    }
+    classifyPositions(xs.data(), os.data(), classes.data(), used);
+    for (uint64_t i = begin; i < end; i++) {
+        uint32_t offset = spans[i - begin].first;
+        int plies = spans[i - begin].second;
+        bool legal = plies > 0;
+        for (int ply = 0; legal && ply + 1 < plies; ply++) legal = classes[offset + ply] == OUTCOME_ONGOING;
+        if (!legal) {
+            worker.skipped++;
+            continue;
         }
-        
-        if (player2Stats.totalGames > 0) {
-            cout << BOLD << "Player: " << GREEN << player2Stats.name << RESET << "\n";
-            cout << "   Wins: " << player2Stats.wins << " | Losses: " << player2Stats.losses;
-            cout << " | Ties: " << player2Stats.ties << "\n";
-            cout << "   Win Rate: " << fixed << setprecision(1) << player2Stats.winRate << "%\n\n";
-        } else {
-            cout << "Player 2: No games played yet.\n\n";
+        gradeRecord(log.at(i), xs.data() + offset, os.data() + offset, worker);
+        worker.games++;
+    }
+}
+
+int runAnalysis(int argc, char* argv[]) {
+    string path = argc > 2 ? argv[2] : GAME_LOG_FILE;
+    int threadCount = argc > 3 ? max(1, atoi(argv[3])) : max(1, (int)std::thread::hardware_concurrency());
+    GameLog log;
+    if (!log.open(path, true)) {
+        cout << "Cannot open game log " << path << "\n";
+        return 1;
+    }
+
+    const uint64_t chunkSize = 1 << 14; // Records per work item
+    uint64_t total = log.size();
+    std::atomic<uint64_t> nextChunk(0);
+    vector<AnalysisWorker> workers(threadCount);
+    auto start = std::chrono::steady_clock::now();
+    auto work = [&](AnalysisWorker& worker) {
+        vector<uint16_t> xs, os; // Reused across chunks
+        vector<uint8_t> classes;
+        for (uint64_t begin = nextChunk++ * chunkSize; begin < total; begin = nextChunk++ * chunkSize) {
+            analyzeRecords(log, begin, min(total, begin + chunkSize), worker, xs, os, classes);
         }
-        
-        if (computerStats.totalGames > 0) {
-            cout << BOLD << "Computer:\n" << RESET;
-            cout << "   Wins: " << computerStats.wins << " | Losses: " << computerStats.losses;
-            cout << " | Ties: " << computerStats.ties << "\n";
-            cout << "   Win Rate: " << fixed << setprecision(1) << computerStats.winRate << "%\n\n";
-        } else {
-            cout << "Computer: No games played yet.\n\n";
+    };
+    vector<std::thread> helpers;
+    for (int t = 1; t < threadCount; t++) helpers.emplace_back(work, std::ref(workers[t]));
+    work(workers[0]);
+    for (std::thread& helper : helpers) helper.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    AnalysisWorker merged;
+    for (AnalysisWorker& worker : workers) {
+        merged.total.add(worker.total);
+        merged.games += worker.games;
+        merged.skipped += worker.skipped;
+        for (auto& entry : worker.byPlayer) merged.byPlayer[entry.first].add(entry.second);
+    }
+
+    const AnalysisTally& t = merged.total;
+    cout << "Analyzed " << merged.games << " games (" << merged.skipped << " skipped: big-board or invalid), "
+         << t.moves << " positions in " << fixed << setprecision(3) << seconds << " s on " << threadCount
+         << " threads (" << setprecision(0) << t.moves / max(seconds, 1e-9) << " positions/s)\n";
+    cout << "   Best: " << t.grades[GRADE_BEST] << " | Inaccuracies: " << t.grades[GRADE_INACCURACY]
+         << " | Blunders: " << t.grades[GRADE_BLUNDER] << " | Accuracy: " << setprecision(1) << t.accuracy() << "%\n\n";
+
+    // Most active players first
+    vector<pair<string, AnalysisTally>> ranked(merged.byPlayer.begin(), merged.byPlayer.end());
+    const size_t shown = min<size_t>(ranked.size(), 20);
+    std::partial_sort(ranked.begin(), ranked.begin() + shown, ranked.end(),
+                      [](const pair<string, AnalysisTally>& a, const pair<string, AnalysisTally>& b) {
+                          return a.second.moves > b.second.moves;
+                      });
+    cout << left << setw(24) << "player" << right << setw(10) << "moves" << setw(10) << "accuracy"
+         << setw(14) << "inaccuracies" << setw(10) << "blunders" << "\n";
+    for (size_t i = 0; i < shown; i++) {
+        const AnalysisTally& p = ranked[i].second;
+        cout << left << setw(24) << ranked[i].first << right << setw(10) << p.moves << setw(9) << setprecision(1)
+             << p.accuracy() << "%" << setw(14) << p.grades[GRADE_INACCURACY] << setw(10) << p.grades[GRADE_BLUNDER] << "\n";
+    }
+    if (ranked.size() > shown) cout << "(" << ranked.size() - shown << " more players)\n";
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Offline opening/endgame book builder
+// Usage: TicTacToe --build-book <4|5|15> [opening plies] [ms per position] [self-play games]
+// Openings are every position up to `opening plies` stones, one per symmetry
+// class. On 4x4 and 5x5, endgames with few empty cells are collected from
+// engine self-play; the search usually solves those outright. The budget
+// defaults to four live move budgets and is never below one.
+// ---------------------------------------------------------------------------
+
+template <int N, int K>
+struct BookPosition {
+    uint64_t key;
+    int symmetry;
+    GridBoard<N, K> board;
+    char mover;
+};
+
+template <int N, int K>
+BookPosition<N, K> makeBookPosition(const GridBoard<N, K>& board, char mover) {
+    SymmetricHash<N> hash(GridEngine<N, K>::zobrist());
+    for (int i = 0; i < N * N; i++) {
+        if (!board.isEmpty(i)) hash.toggle(i, board.at(i));
+    }
+    return BookPosition<N, K>{hash.canonical(mover), hash.canonicalSymmetry(), board, mover};
+}
+
+template <int N, int K>
+void collectOpenings(GridBoard<N, K>& board, char mover, int pliesLeft, vector<BookPosition<N, K>>& out) {
+    out.push_back(makeBookPosition(board, mover));
+    if (pliesLeft == 0) return;
+    char other = (mover == 'X' ? 'O' : 'X');
+    for (int i = 0; i < N * N; i++) {
+        if (!isCandidateMove(board, i)) continue;
+        board.place(i, mover);
+        if (!board.winsAt(i, mover) && !board.isFull()) collectOpenings(board, other, pliesLeft - 1, out);
+        board.remove(i);
+    }
+}
+
+template <int N, int K>
+int buildOpeningBook(int openingPlies, int budgetMs, int selfPlayGames) {
+    auto start = std::chrono::steady_clock::now();
+    vector<BookPosition<N, K>> positions;
+    GridBoard<N, K> board;
+    collectOpenings(board, 'X', openingPlies, positions);
+    size_t openings = positions.size();
+
+    if (N <= 6) {
+        const int endgameEmpty = (N <= 4) ? 8 : 10;
+        GridEngine<N, K> engine;
+        GameRng rng(0xB00C);
+        for (int game = 0; game < selfPlayGames; game++) {
+            board.clear();
+            char mover = 'X';
+            for (int ply = 0; ; ply++) {
+                int move;
+                if (ply < 3) { // Random openings so the games differ
+                    do move = (int)rng.below(N * N); while (!board.isEmpty(move));
+                } else {
+                    move = engine.findBestMove(board, mover, 20).move;
+                }
+                board.place(move, mover);
+                if (board.winsAt(move, mover) || board.isFull()) break;
+                mover = (mover == 'X' ? 'O' : 'X');
+                if (N * N - board.moveCount <= endgameEmpty) positions.push_back(makeBookPosition(board, mover));
+            }
         }
-        
-        cout << BOLD << "Total Games Played: " << totalGamesPlayed << "\n" << RESET;
-        
-        cout << "\nPress any key to continue...";
-        getch_custom();
     }
-    
-    void showGameHistory() {
-        clearScreen();
-        printHeader();
-        cout << BOLD << YELLOW << "*** GAME HISTORY (Last 10 games) ***\n\n" << RESET;
-        
-        if (gameHistory.empty()) {
-            cout << RED << "No games played yet!\n" << RESET;
-        } else {
-            for (int i = gameHistory.size() - 1; i >= 0; i--) {
-                cout << (gameHistory.size() - i) << ". " << GREEN << gameHistory[i] << RESET << "\n";
+
+    std::sort(positions.begin(), positions.end(),
+              [](const BookPosition<N, K>& a, const BookPosition<N, K>& b) { return a.key < b.key; });
+    positions.erase(std::unique(positions.begin(), positions.end(),
+                                [](const BookPosition<N, K>& a, const BookPosition<N, K>& b) { return a.key == b.key; }),
+                    positions.end());
+    cout << "Book " << N << "x" << N << " (" << K << " in a row): " << openings << " opening and "
+         << (N <= 6 ? selfPlayGames : 0) << " self-play games -> " << positions.size() << " unique positions\n";
+
+    // Positions are independent, so each thread takes the next one with its own
+    // engines. A position the deep search does not solve is only kept if it got
+    // deeper than a live search within GRID_MOVE_BUDGET_MS, since the game
+    // plays book moves without searching.
+    vector<BookEntry> entries(positions.size());
+    vector<char> keep(positions.size(), 0);
+    std::atomic<size_t> nextPosition(0);
+    std::atomic<int> solved(0);
+    int threadCount = max(1, (int)std::thread::hardware_concurrency());
+    auto work = [&]() {
+        GridEngine<N, K> engine, liveEngine;
+        for (size_t p = nextPosition++; p < positions.size(); p = nextPosition++) {
+            BookPosition<N, K>& pos = positions[p];
+            typename GridEngine<N, K>::SearchResult result = engine.findBestMove(pos.board, pos.mover, budgetMs);
+            int value = result.score;
+            if (value > GridEngine<N, K>::GRID_WIN / 2) value = BOOK_WIN - (GridEngine<N, K>::GRID_WIN - value);
+            else if (value < -GridEngine<N, K>::GRID_WIN / 2) value = -BOOK_WIN + (GridEngine<N, K>::GRID_WIN + value);
+            else value = max(-BOOK_WIN + 1000, min(BOOK_WIN - 1000, value));
+            bool isSolved = abs(value) > BOOK_WIN - 1000 || !result.timedOut;
+            if (isSolved) {
+                solved++;
+                keep[p] = 1;
+            } else {
+                keep[p] = result.depth > liveEngine.findBestMove(pos.board, pos.mover, GRID_MOVE_BUDGET_MS).depth;
             }
+            entries[p].value = (int16_t)value;
+            entries[p].move = GridEngine<N, K>::zobrist().transform[pos.symmetry][result.move];
+            entries[p].depth = isSolved ? BOOK_SOLVED_DEPTH : (uint8_t)min(result.depth, 254);
         }
-        
-        cout << "\nPress any key to continue...";
-        getch_custom();
+    };
+    vector<std::thread> helpers;
+    for (int t = 1; t < threadCount; t++) helpers.emplace_back(work);
+    work();
+    for (std::thread& helper : helpers) helper.join();
+    size_t kept = 0;
+    for (size_t p = 0; p < positions.size(); p++) { // Keys stay sorted
+        if (!keep[p]) continue;
+        positions[kept] = positions[p];
+        entries[kept] = entries[p];
+        kept++;
     }
-    
-    bool playAgain() {
-        char choice;
-        cout << BOLD << "\nPlay another round? (y/n): " << RESET;
-        cin >> choice;
-        playSound("select");
-        // Clear buffer after char input
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        return (choice == 'y' || choice == 'Y');
+    size_t dropped = positions.size() - kept;
+    positions.erase(positions.begin() + kept, positions.end());
+    entries.resize(kept);
+
+    string path = openingBookPath(N, K);
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        cout << "Cannot write " << path << "\n";
+        return 1;
     }
-    
-    void playVsComputer() {
-        string playerName;
-        cout << BOLD << "Enter your name: " << RESET;
-        getline(cin, playerName);
-        
-        int difficulty = getDifficultyLevel(); // getDifficultyLevel() membersihkan buffernya sendiri
-        string difficultyName[] = {"", "Easy", "Medium", "Hard", "Impossible"};
-        cout << BOLD << "\nStarting game against " << CYAN << difficultyName[difficulty] << RESET << " AI...\n" << RESET;
-        customSleep(1500);
-        
-        do {
-            clearBoard();
-            bool gameRunning = true;
-            totalGamesPlayed++;
-            
-            while (gameRunning) {
-                clearScreen();
-                printHeader();
-                cout << BOLD << "Mode: " << GREEN << "VS Computer (" << difficultyName[difficulty] << ")\n" << RESET;
-                cout << BOLD << "Player: " << RED << playerName << RESET << " (X) vs " << GREEN << "Computer" << RESET << " (O)\n" << RESET;
-                drawAdvancedBoard();
-                
-                // Player move
-                playerMove('X', playerName); // playerMove() membersihkan buffernya sendiri
-                char winner = checkWinner();
-                if (winner == 'X') {
-                    displayWinner('X', playerName, "Computer");
-                    player1Stats.name = playerName;
-                    player1Stats.updateStats(1);
-                    computerStats.name = "Computer";
-                    computerStats.updateStats(-1);
-                    updateGameHistory(playerName + " defeated Computer (" + difficultyName[difficulty] + ")");
-                    gameRunning = false;
-                    break;
-                }
-                if (isTie()) {
-                    displayTie();
-                    player1Stats.name = playerName;
-                    player1Stats.updateStats(0);
-                    computerStats.name = "Computer";
-                    computerStats.updateStats(0);
-                    updateGameHistory("Tie: " + playerName + " vs Computer (" + difficultyName[difficulty] + ")");
-                    gameRunning = false;
-                    break;
-                }
-                
-                // Computer move
-                clearScreen();
-                printHeader();
-                cout << BOLD << "Mode: " << GREEN << "VS Computer (" << difficultyName[difficulty] << ")\n" << RESET;
-                cout << BOLD << "Player: " << RED << playerName << RESET << " (X) vs " << GREEN << "Computer" << RESET << " (O)\n" << RESET;
-                drawAdvancedBoard();
-                computerMove('O', 'X', difficulty);
-                winner = checkWinner();
-                if (winner == 'O') {
-                    displayWinner('O', playerName, "Computer");
-                    player1Stats.name = playerName;
-                    player1Stats.updateStats(-1);
-                    computerStats.name = "Computer";
-                    computerStats.updateStats(1);
-                    updateGameHistory("Computer (" + difficultyName[difficulty] + ") defeated " + playerName);
-                    gameRunning = false;
-                    break;
-                }
-                if (isTie()) {
-                    displayTie();
-                    player1Stats.name = playerName;
-                    player1Stats.updateStats(0);
-                    computerStats.name = "Computer";
-                    computerStats.updateStats(0);
-                    updateGameHistory("Tie: " + playerName + " vs Computer (" + difficultyName[difficulty] + ")");
-                    gameRunning = false;
-                    break;
-                }
-            }
-        } while (playAgain());
+    char header[64] = {};
+    uint32_t fields[4] = {BOOK_VERSION, (uint32_t)N, (uint32_t)K, (uint32_t)sizeof(BookEntry)};
+    uint64_t count = positions.size();
+    memcpy(header, "TTTBOOK", 8);
+    memcpy(header + 8, fields, sizeof(fields));
+    memcpy(header + 24, &count, sizeof(count));
+    fwrite(header, sizeof(header), 1, out);
+    for (const BookPosition<N, K>& pos : positions) fwrite(&pos.key, sizeof(pos.key), 1, out);
+    fwrite(entries.data(), sizeof(BookEntry), entries.size(), out);
+    fclose(out);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "Wrote " << path << ": " << count << " entries (" << solved << " solved, " << dropped
+         << " dropped as no deeper than a live search), "
+         << (64 + count * (sizeof(uint64_t) + sizeof(BookEntry))) << " bytes, " << fixed << setprecision(1)
+         << seconds << " s on " << threadCount << " threads\n";
+    return 0;
+}
+
+int runBookBuilder(int argc, char* argv[]) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " --build-book <4|5|15> [opening plies] [ms per position] [self-play games]\n";
+        return 1;
     }
-    
-    void playMultiplayer() {
-        string player1Name, player2Name;
-        cout << BOLD << "Enter Player 1 name (X): " << RESET;
-        getline(cin, player1Name);
-        cout << BOLD << "Enter Player 2 name (O): " << RESET;
-        getline(cin, player2Name);
-        
-        do {
-            clearBoard();
-            bool gameRunning = true;
-            totalGamesPlayed++;
-            
-            while (gameRunning) {
-                // Player 1 move
-                clearScreen();
-                printHeader();
-                cout << BOLD << "Mode: " << CYAN << "Multiplayer\n" << RESET;
-                cout << BOLD << RED << player1Name << RESET << " (X) vs " << GREEN << player2Name << RESET << " (O)\n" << RESET;
-                drawAdvancedBoard();
-                playerMove('X', player1Name); // playerMove() membersihkan buffernya sendiri
-                char winner = checkWinner();
-                if (winner == 'X') {
-                    displayWinner('X', player1Name, player2Name);
-                    player1Stats.name = player1Name;
-                    player1Stats.updateStats(1);
-                    player2Stats.name = player2Name;
-                    player2Stats.updateStats(-1);
-                    updateGameHistory(player1Name + " defeated " + player2Name);
-                    gameRunning = false;
-                    break;
-                }
-                if (isTie()) {
-                    displayTie();
-                    player1Stats.name = player1Name;
-                    player1Stats.updateStats(0);
-                    player2Stats.name = player2Name;
-                    player2Stats.updateStats(0);
-                    updateGameHistory("Tie: " + player1Name + " vs " + player2Name);
-                    gameRunning = false;
-                    break;
-                }
-                
-                // Player 2 move
-                clearScreen();
-                printHeader();
-                cout << BOLD << "Mode: " << CYAN << "Multiplayer\n" << RESET;
-                cout << BOLD << RED << player1Name << RESET << " (X) vs " << GREEN << player2Name << RESET << " (O)\n" << RESET;
-                drawAdvancedBoard();
-                playerMove('O', player2Name); // playerMove() membersihkan buffernya sendiri
-                winner = checkWinner();
-                if (winner == 'O') {
-                    displayWinner('O', player1Name, player2Name);
-                    player1Stats.name = player1Name;
-                    player1Stats.updateStats(-1);
-                    player2Stats.name = player2Name;
-                    player2Stats.updateStats(1);
-                    updateGameHistory(player2Name + " defeated " + player1Name);
-                    gameRunning = false;
-                    break;
-                }
-                if (isTie()) {
-                    displayTie();
-                    player1Stats.name = player1Name;
-                    player1Stats.updateStats(0);
-                    player2Stats.name = player2Name;
-                    player2Stats.updateStats(0);
-                    updateGameHistory("Tie: " + player1Name + " vs " + player2Name);
-                    gameRunning = false;
-                    break;
+    int size = atoi(argv[2]);
+    int plies = argc > 3 ? max(0, atoi(argv[3])) : (size == 15 ? 2 : 3);
+    int budgetMs = argc > 4 ? atoi(argv[4]) : 4 * GRID_MOVE_BUDGET_MS;
+    if (budgetMs < GRID_MOVE_BUDGET_MS) {
+        cout << "Searching " << GRID_MOVE_BUDGET_MS << " ms per position: a shorter budget than the live engine's cannot improve on it\n";
+        budgetMs = GRID_MOVE_BUDGET_MS;
+    }
+    int games = argc > 5 ? max(0, atoi(argv[5])) : 64;
+    if (size == 4) return buildOpeningBook<4, 4>(plies, budgetMs, games);
+    if (size == 5) return buildOpeningBook<5, 4>(plies, budgetMs, games);
+    if (size == 15) return buildOpeningBook<15, 5>(plies, budgetMs, games);
+    cout << "Board size must be 4, 5 or 15\n";
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Retrograde solver: fills tictactoe_solved_<N>x<N>k<K>.dat layer by layer,
+// each layer split over the threads. Rerunning an interrupted solve resumes
+// at the first unfinished layer. The 3x3 table is checked against the
+// perfect-play table.
+// Usage: TicTacToe --solve [3|4] [threads]
+// ---------------------------------------------------------------------------
+
+#ifndef _WIN32
+// One per worker, padded to a cache line so workers never share one
+struct alignas(64) SolveTally {
+    uint64_t counts[3] = {0, 0, 0}; // Win / draw / loss
+};
+
+// Solves every position with `layer` stones; all positions with one stone
+// more are already final
+void solveLayer(SolvedTable& table, const SolverGeometry& geometry, int layer, int threads, uint64_t counts[3]) {
+    int xStones = (layer + 1) / 2, oStones = layer / 2;
+    char mover = (xStones == oStones) ? 'X' : 'O';
+    uint32_t step = (mover == 'X' ? 1 : 2);
+    uint16_t full = (uint16_t)((1u << geometry.cells) - 1);
+    vector<uint16_t> xMasks;
+    for (uint32_t mask = 0; mask <= full; mask++) {
+        if (stoneCount((uint16_t)mask) == xStones) xMasks.push_back((uint16_t)mask);
+    }
+
+    vector<SolveTally> tallies(threads);
+    std::atomic<size_t> next(0);
+    vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            SolveTally local;
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < xMasks.size();) {
+                uint16_t x = xMasks[i], open = (uint16_t)(full & ~x);
+                // Every subset of the open cells with the right number of O stones
+                for (uint16_t o = open; ; o = (uint16_t)((o - 1) & open)) {
+                    if (stoneCount(o) == oStones) {
+                        uint32_t idx = geometry.index(x, o);
+                        int value;
+                        if (geometry.hasLine(mover == 'X' ? o : x)) {
+                            value = SOLVED_LOSS; // The previous move won
+                        } else if (layer == geometry.cells) {
+                            value = SOLVED_DRAW;
+                        } else {
+                            value = SOLVED_LOSS;
+                            uint16_t empty = (uint16_t)(open & ~o);
+                            for (int c = 0; c < geometry.cells && value != SOLVED_WIN; c++) {
+                                if (!(empty >> c & 1)) continue;
+                                int child = table.value(idx + step * geometry.power3[c]);
+                                if (child == SOLVED_LOSS) value = SOLVED_WIN;
+                                else if (child == SOLVED_DRAW) value = SOLVED_DRAW;
+                            }
+                        }
+                        table.store(idx, value);
+                        local.counts[value - 1]++;
+                    }
+                    if (o == 0) break;
                 }
             }
-        } while (playAgain());
+            tallies[t] = local;
+        });
     }
-    
-    void run() {
-        srand(time(0));
-        int choice;
-        
-        cout << BOLD << BG_MAGENTA << WHITE;
-        typeMessage("Initializing Bern's Tic Tac Toe Games...", 40);
-        cout << RESET << "\n";
-        
-        customSleep(1500);
-        
-        do {
-            showMenu();
-            cin >> choice;
-            playSound("select");
-            
-            // Membersihkan buffer setelah membaca integer 'choice'
-            // Ini penting agar `getline` berikutnya tidak membaca newline yang tersisa.
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-            
-            switch (choice) {
-                case 1:
-                    playVsComputer();
-                    break;
-                case 2:
-                    playMultiplayer();
-                    break;
-                case 3:
-                    showStatistics();
-                    break;
-                case 4:
-                    soundEnabled = !soundEnabled;
-                    cout << BOLD << "Sound " << (soundEnabled ? GREEN "enabled" : RED "disabled") << "!\n" << RESET;
-                    customSleep(1000);
-                    break;
-                case 5:
-                    showGameHistory();
-                    break;
-                case 6:
-                    clearScreen();
-                    cout << BOLD << BG_BLUE << WHITE;
-                    typeMessage("Thanks for playing Bern's Tic Tac Toe Game!\n", 40);
-                    typeMessage("Come back soon for more epic battles!\n", 40);
-                    cout << RESET;
-                    customSleep(2000);
-                    break;
-                default:
-                    cout << RED << "Invalid choice! Please select 1-6.\n" << RESET;
-                    customSleep(1000);
+    for (std::thread& w : workers) w.join();
+    for (const SolveTally& tally : tallies) {
+        for (int v = 0; v < 3; v++) counts[v] += tally.counts[v];
+    }
+}
+
+int runSolver(int argc, char* argv[]) {
+    int size = argc > 2 ? atoi(argv[2]) : 4;
+    int threads = argc > 3 ? max(1, atoi(argv[3])) : max(1, (int)std::thread::hardware_concurrency());
+    if (size != 3 && size != 4) {
+        cout << "Board size must be 3 or 4 (the table holds 3^cells positions)\n";
+        return 1;
+    }
+    SolverGeometry geometry(size, size);
+    string path = solvedTablePath(size, size);
+    SolvedTable table;
+    if (!table.openForSolving(path, size, size, geometry.positions)) {
+        cout << RED << "Cannot open " << path << " (or it belongs to another board or is truncated; delete it to start over)\n"
+             << RESET;
+        return 1;
+    }
+    const char* valueName[] = {"unknown", "win", "draw", "loss"};
+    if (table.isComplete()) {
+        cout << path << " is already complete\n";
+    } else {
+        if (table.nextLayer() < geometry.cells) cout << "Resuming at layer " << table.nextLayer() << "\n";
+        cout << BOLD << "Solving " << size << "x" << size << " (" << geometry.positions << " indices) on " << threads
+             << " thread(s) into " << path << RESET << "\n";
+        cout << left << setw(8) << "layer" << right << setw(12) << "positions" << setw(12) << "wins" << setw(12) << "draws"
+             << setw(12) << "losses" << setw(10) << "ms" << "\n";
+        auto start = std::chrono::steady_clock::now();
+        for (int layer = table.nextLayer(); layer >= 0; layer--) {
+            auto layerStart = std::chrono::steady_clock::now();
+            uint64_t counts[3] = {0, 0, 0};
+            solveLayer(table, geometry, layer, threads, counts);
+            table.commitLayer(layer, counts);
+            cout << left << setw(8) << layer << right << setw(12) << (counts[0] + counts[1] + counts[2]) << setw(12) << counts[0]
+                 << setw(12) << counts[1] << setw(12) << counts[2] << setw(10) << fixed << setprecision(0)
+                 << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - layerStart).count() << "\n";
+        }
+        cout << "Solved in " << setprecision(2) << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+             << " s\n";
+    }
+    const uint64_t* solved = table.solvedCounts();
+    cout << "Empty board: " << BOLD << valueName[table.value(0)] << RESET << " for X | positions: " << solved[0] << " wins, "
+         << solved[1] << " draws, " << solved[2] << " losses (side to move)\n";
+
+    if (size == 3) {
+        int checked = 0, mismatches = 0;
+        for (uint32_t x = 0; x < 512; x++) {
+            for (uint32_t o = 0; o < 512; o++) {
+                int xs = stoneCount((uint16_t)x), os = stoneCount((uint16_t)o);
+                if ((x & o) || (xs != os && xs != os + 1) || hasLineMask((uint16_t)(xs == os ? x : o))) continue;
+                int idx = positionIndex((uint16_t)x, (uint16_t)o);
+                int expected = PERFECT_PLAY.value(idx) > 0 ? SOLVED_WIN : (PERFECT_PLAY.value(idx) < 0 ? SOLVED_LOSS : SOLVED_DRAW);
+                checked++;
+                if (table.value((uint32_t)idx) != expected) mismatches++;
             }
-        } while (choice != 6);
+        }
+        cout << "Checked " << checked << " positions against the perfect-play table: " << mismatches << " mismatches\n";
+        return mismatches == 0 ? 0 : 1;
     }
-};
+    return 0;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// MCTS thread scaling: playouts per second from a fixed position with 1, 2,
+// 4, ... threads up to the core count.
+// Usage: TicTacToe --mcts-scaling [budget ms]
+// ---------------------------------------------------------------------------
+
+int runMctsScaling(int argc, char* argv[]) {
+    int budgetMs = argc > 2 ? max(100, atoi(argv[2])) : 1000;
+    int maxThreads = max(1, (int)std::thread::hardware_concurrency());
+    UltimateBoard position;
+    position.play(40); // Center of the center sub-board
+    cout << left << setw(10) << "threads" << right << setw(14) << "playouts" << setw(16) << "playouts/s"
+         << setw(10) << "speedup" << setw(8) << "move" << "\n";
+    double baseline = 0;
+    for (int threads = 1; ; threads = min(threads * 2, maxThreads)) {
+        UltimateMcts engine(threads);
+        UltimateMcts::SearchResult result = engine.findBestMove(position, budgetMs, 12345);
+        double rate = result.playouts * 1000.0 / max(result.elapsedMs, 1.0);
+        if (threads == 1) baseline = rate;
+        cout << left << setw(10) << threads << right << setw(14) << result.playouts << setw(16) << fixed
+             << setprecision(0) << rate << setw(9) << setprecision(2) << rate / baseline << "x"
+             << setw(5) << (result.move / 9 + 1) << "/" << (result.move % 9 + 1) << "\n";
+        if (threads == maxThreads) break;
+    }
+    return 0;
+}
 
-int main() {
-    TicTacToeGame game;
+int main(int argc, char* argv[]) {
+    if (getenv("TICTACTOE_DRIVEN")) { // Child of --drive
+        skipCosmeticDelays = true;
+        terminal.announceInput(true);
+    }
+    if (argc > 1 && string(argv[1]) == "--drive") {
+#ifndef _WIN32
+        return runInputDriver(argc, argv);
+#else
+        cout << "The input driver needs a POSIX pseudo-terminal.\n";
+        return 1;
+#endif
+    }
+    if (argc > 1 && string(argv[1]) == "--replay") {
+        return runReplay(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--simulate") {
+        return runSimulation(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--train") {
+        return runTrainer(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--mcts-scaling") {
+        return runMctsScaling(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--perft") {
+        return runPerft(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--analyze") {
+        return runAnalysis(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--build-book") {
+        return runBookBuilder(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--solve") {
+#ifndef _WIN32
+        return runSolver(argc, argv);
+#else
+        cout << "The solver needs POSIX mmap.\n";
+        return 1;
+#endif
+    }
+    if (argc > 1 && (string(argv[1]) == "--serve" || string(argv[1]) == "--loadgen")) {
+#ifdef __linux__
+        return string(argv[1]) == "--serve" ? runServer(argc, argv) : runLoadGenerator(argc, argv);
+#else
+        cout << "Server mode needs Linux (epoll).\n";
+        return 1;
+#endif
+    }
+    size_t historyCapacity = 10;
+    if (argc > 2 && string(argv[1]) == "--history") {
+        historyCapacity = (size_t)max(1, atoi(argv[2]));
+    }
+    TicTacToeGame game(historyCapacity);
+    if (argc > 1 && string(argv[1]) == "--verify-table") {
+        return game.verifyPerfectPlayTable() == 0 ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        game.runBenchmarks(argc > 2 && string(argv[2]) == "--json");
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--search-report") {
+        game.searchReport();
+        return 0;
+    }
     game.run();
     return 0;
 }
\ No newline at end of file